@@ -13,6 +13,7 @@
 #include <vector>
 
 #include <Attractor.h>
+#include <Mesh.h>
 #include <Triplet.h>
 
 const float CUBE_HALF_SIZE = 400.0;
@@ -24,6 +25,14 @@ const float RED_G          = 0.35294117647;
 const float RED_B          = 0.3725490196;
 const float DEFAULT_WHITE  = 0.96078431372;
 
+// seconds a colour change takes to fade in, about 100 frames at 60Hz
+const float COLOUR_FADE_TIME = 1.6f;
+
+// world size of a drawn agent (cone height times model scale) and the smallest
+// on-screen size in pixels still worth drawing as a cone
+const float AGENT_DRAW_SIZE  = 10.0f;
+const float AGENT_MIN_PIXELS = 2.0f;
+
 class Agent
 {
 private:
@@ -39,33 +48,31 @@ private:
     Triplet MIN          = Triplet(-CUBE_HALF_SIZE, -CUBE_HALF_SIZE, -CUBE_HALF_SIZE);
     Triplet MAX          = Triplet(CUBE_HALF_SIZE, CUBE_HALF_SIZE, CUBE_HALF_SIZE);
 
-    int colourSwapTime   = 0;
+    float colourChangeTime = -COLOUR_FADE_TIME;
 
     static glm::quat rotationBetweenVectors(glm::vec3 start, glm::vec3 dest);
 public:
     Agent();
 
     Triplet getPosition() const;
+    Triplet getDirection() const;
     Triplet getColour() const;
     Triplet getOldColour() const;
-    void setOldColour(Triplet value);
-
-    int getColourSwapTime() const;
-    void setColourSwapTime(int value);
+    float getColourChangeTime() const;
 
-    void setColour(int colourCount);
+    void setColour(int colourCount, float time);
     void computeChange(Triplet newDirection, float count, Triplet direction, float maxForce) const;
 
     Triplet repulsion(std::vector<Agent> &agents, float radiusRepulsion,float blindAngle, float maxForce);
-    Triplet orientation(std::vector<Agent> &agents, float radiusRepulsion, float radiusOrientation, float blindAngle, float maxForce);
+    Triplet orientation(std::vector<Agent> &agents, float radiusRepulsion, float radiusOrientation, float blindAngle, float maxForce, float time);
     Triplet attraction(std::vector<Agent> &agents, float radiusOrientation, float radiusAttraction, float blindAngle, float maxForce);
     Triplet bounding() const;
 
-    static void setupDraw(unsigned int *VBO, unsigned int *normalVBO, unsigned int *EBO, unsigned int *VAO);
-    void transform(glm::mat4 *agentModel);
-    static void draw();
-    void move(float speed, std::vector<Attractor> attractors, float deltaTime);
-    void step(std::vector<Agent> &agents, float radiusRepulsion, float radiusOrientation, float radiusAttraction, float angle, float maxForce);
+    static void geometry(std::vector<float> &vertices, std::vector<unsigned int> &indices);
+    void transform(glm::mat4 *agentModel) const;
+    void instance(InstanceData *agentInstance) const;
+    int move(float speed, const std::vector<Attractor> &attractors, float deltaTime, float *attractorDistance);
+    void step(std::vector<Agent> &agents, float radiusRepulsion, float radiusOrientation, float radiusAttraction, float angle, float maxForce, float time);
 };
 
 #endif
@@ -10,6 +10,9 @@
 
 #include <glm/glm.hpp>
 
+#include <vector>
+
+#include <Mesh.h>
 #include <Triplet.h>
 
 class Attractor
@@ -18,6 +21,7 @@ private:
     Triplet position;
     Triplet colour;
 
+    int pitch;
     int tone;
     int strength;
     int mode;
@@ -28,10 +32,13 @@ public:
 
     Triplet getPosition() const;
     Triplet getColour() const;
+    int getPitch() const;
+    int getTone() const;
+    int getStrength() const;
 
-    static void setupDraw(unsigned int *VBO, unsigned int *EBO, unsigned int *VAO);
-    void transform(glm::mat4 *attractorModel);
-    static void draw();
+    static void geometry(std::vector<float> &vertices, std::vector<unsigned int> &indices);
+    void transform(glm::mat4 *attractorModel) const;
+    void instance(InstanceData *attractorInstance) const;
 };
 
 #endif
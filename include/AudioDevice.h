@@ -0,0 +1,72 @@
+/**
+ * Audio output stream on a chosen backend, or a null device keeping time without hardware
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef AUDIO_DEVICE_H_
+#define AUDIO_DEVICE_H_
+
+#include <stk/RtAudio.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+const int AUDIO_BACKEND_DEFAULT = 0;
+const int AUDIO_BACKEND_ALSA    = 1;
+const int AUDIO_BACKEND_JACK    = 2;
+const int AUDIO_BACKEND_NULL    = 3;
+
+struct AudioConfig {
+    int          backend      = AUDIO_BACKEND_DEFAULT;
+    unsigned int bufferFrames = 0;     // 0 to probe for the smallest buffer that keeps up
+    unsigned int periods      = 0;     // 0 for the backend's default
+    unsigned int sampleRate   = 44100;
+    unsigned int channels     = 2;
+};
+
+class AudioDevice
+{
+private:
+    std::unique_ptr<RtAudio> dac;
+
+    // the null backend calls back from its own thread at the rate a device would
+    std::thread       worker;
+    std::atomic<bool> running {false};
+
+    RtAudioCallback callback = NULL;
+    void           *userData = NULL;
+
+    int          backend      = AUDIO_BACKEND_DEFAULT;
+    unsigned int bufferFrames = 0;
+    unsigned int periods      = 0;
+    unsigned int sampleRate   = 0;
+    unsigned int channels     = 0;
+
+    void runNull();
+public:
+    AudioDevice() = default;
+    ~AudioDevice();
+
+    AudioDevice(const AudioDevice&) = delete;
+    AudioDevice &operator=(const AudioDevice&) = delete;
+
+    bool open(const AudioConfig &config, RtAudioCallback streamCallback, void *streamData);
+    bool start();
+    void close();
+
+    bool isOpen() const;
+    unsigned int getBufferFrames() const;
+    unsigned int getPeriods() const;
+    unsigned int getSampleRate() const;
+    unsigned int getChannels() const;
+    double getLatency() const;
+
+    static const char *getBackendName(int backend);
+    static int parseBackend(const std::string &name);
+};
+
+#endif
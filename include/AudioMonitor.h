@@ -0,0 +1,48 @@
+/**
+ * Timing of the audio callback against its deadline
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef AUDIO_MONITOR_H_
+#define AUDIO_MONITOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+const int   AUDIO_LOAD_BINS  = 16;   // histogram of callback load
+const float AUDIO_LOAD_WIDTH = 0.1f; // share of the buffer period per bin, the last bin takes the rest
+
+class AudioMonitor
+{
+private:
+    // written by the audio callback only, read from anywhere
+    std::atomic<unsigned int> histogram[AUDIO_LOAD_BINS];
+    std::atomic<unsigned int> callbacks;
+    std::atomic<unsigned int> underflows; // reported by the device
+    std::atomic<unsigned int> overruns;   // callbacks that took longer than their buffer lasts
+    std::atomic<float>        worstLoad;
+    std::atomic<float>        lastLoad;
+public:
+    AudioMonitor();
+
+    AudioMonitor(const AudioMonitor&) = delete;
+    AudioMonitor &operator=(const AudioMonitor&) = delete;
+
+    void reset();
+    void record(std::chrono::steady_clock::time_point started, unsigned int frames, double sampleRate, bool underflow);
+
+    unsigned int getCallbacks() const;
+    unsigned int getUnderflows() const;
+    unsigned int getOverruns() const;
+    float getWorstLoad() const;
+    float getLastLoad() const;
+    unsigned int getBin(int bin) const;
+    float getPercentile(float percentile) const;
+
+    void report(std::ostream &stream) const;
+};
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * Musical time on the audio clock, converting between sample frames and bars, beats and ticks
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef BEAT_CLOCK_H_
+#define BEAT_CLOCK_H_
+
+const int BEAT_TICKS = 480; // ticks per beat, the finest grid notes can land on
+
+class BeatClock
+{
+private:
+    double sampleRate;
+    float  tempo;       // beats per minute
+    int    beatsPerBar;
+
+    // a tempo change restarts the clock from the frame and tick it happened on
+    unsigned long long originFrame;
+    double             originTick;
+    double             framesPerTick;
+public:
+    BeatClock(double sampleRate, float tempo, int beatsPerBar);
+
+    float getTempo() const;
+    void setTempo(float bpm, unsigned long long frame);
+
+    int getBeatsPerBar() const;
+    void setBeatsPerBar(int beats);
+
+    double getTick(unsigned long long frame) const;
+    unsigned long long getFrame(double tick) const;
+
+    unsigned long long quantise(unsigned long long frame, int grid) const;
+    unsigned long long nextBar(unsigned long long frame) const;
+    float getBarPosition(unsigned long long frame) const;
+    double getBarSeconds() const;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * Groups of agents within reach of each other, found every simulation step
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef CLUSTERS_H_
+#define CLUSTERS_H_
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include <Agent.h>
+#include <Triplet.h>
+
+const int CLUSTER_GRID_MAX     = 64;   // cells per axis, bounds the grid when the radius is small
+const int CLUSTER_MIN_SIZE     = 5;    // smaller groups are stragglers, not flocks
+const int CLUSTER_PARALLEL_MIN = 4096; // fewer agents are clustered on the calling thread
+
+struct Cluster {
+    Triplet centroid;
+    Triplet velocity;
+    int     size;
+};
+
+class Clusters
+{
+private:
+    std::vector<Cluster> clusters;
+
+    // scratch kept between steps so clustering doesn't allocate once warmed up
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> sorted;
+    std::vector<int>       cellOf;
+    std::vector<int>       cellStart;
+    std::vector<int>       order;
+    std::vector<int>       parent;
+    std::vector<int>       count;
+    std::vector<int>       label;
+
+    int   dimension = 0; // grid cells per axis
+    float radius2   = 0.0f;
+
+    int find(int agent);
+    void unite(int a, int b);
+    void joinSlabs(int zBegin, int zEnd, bool border);
+public:
+    Clusters() = default;
+
+    Clusters(const Clusters&) = delete;
+    Clusters &operator=(const Clusters&) = delete;
+
+    const std::vector<Cluster> &get() const;
+
+    void update(const std::vector<Agent> &agents, float radius, float speed);
+};
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * Live frame capture through a ring of pixel buffer objects and a writer thread
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef FRAME_CAPTURE_H_
+#define FRAME_CAPTURE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int CAPTURE_Y4M     = 0;
+const int CAPTURE_RAW     = 1;
+
+const int CAPTURE_BUFFERS = 3; // frames a readback is left in flight before mapping
+const int CAPTURE_FRAMES  = 8; // frames queued for the writer before new ones are dropped
+
+class FrameCapture
+{
+private:
+    int width  = 0;
+    int height = 0;
+    int format = CAPTURE_Y4M;
+
+    bool recording = false;
+
+    unsigned int buffers[CAPTURE_BUFFERS];
+    bool  pending[CAPTURE_BUFFERS];
+    int   bufferIndex = 0;
+
+    // filled frames travel to the writer and come back empty, nothing is allocated while recording
+    std::vector<std::vector<unsigned char>> frames;
+    std::vector<int> freeFrames;
+    std::deque<int>  queuedFrames;
+
+    std::mutex              queueMutex;
+    std::condition_variable queueCondition;
+    bool                    stopping = false;
+
+    std::thread   writer;
+    std::ofstream file;
+
+    int captured = 0;
+    int dropped  = 0;
+
+    void collect(int index);
+    void write();
+    void writeY4M(const unsigned char *pixels, std::vector<unsigned char> &planes);
+    void writeRaw(const unsigned char *pixels);
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture &operator=(const FrameCapture&) = delete;
+
+    bool start(const std::string &path, int width, int height, int format, int frameRate);
+    void stop();
+
+    void capture();
+
+    bool isRecording() const;
+    int getWidth() const;
+    int getHeight() const;
+    int getCaptured() const;
+    int getDropped() const;
+};
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * Frame pacing for the render loop, with frame time jitter statistics
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+#include <chrono>
+
+const int PACING_VSYNC    = 0;
+const int PACING_HYBRID   = 1;
+const int PACING_UNCAPPED = 2;
+
+const int FRAME_HISTORY   = 240;
+
+class FramePacer
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    int    mode;
+    double targetInterval; // seconds
+    double spinTail;       // seconds
+
+    Clock::time_point deadline;
+    Clock::time_point lastFrame;
+
+    float intervals[FRAME_HISTORY];
+    int   intervalIndex = 0;
+    int   intervalCount = 0;
+
+    void record(Clock::time_point now);
+public:
+    FramePacer(double targetInterval, int mode);
+
+    int getMode() const;
+    void setMode(int value);
+
+    float getSpinTail() const;
+    void setSpinTail(float value);
+
+    double getTargetInterval() const;
+
+    void wait();
+
+    float getMeanInterval() const;
+    float getJitter() const;
+    float getWorstInterval() const;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * GPU geometry for the scene primitives, built once and shared by every draw
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef MESH_H_
+#define MESH_H_
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+const int MESH_CONE      = 0;
+const int MESH_SPHERE    = 1;
+const int MESH_WIRE_CUBE = 2;
+const int MESH_POINT     = 3;
+const int MESH_COUNT     = 4;
+
+// per-instance vertex data, colour is blended on the GPU from the change time
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec3 fromColour;
+    glm::vec3 toColour;
+    float     changeTime;
+};
+
+class Mesh
+{
+private:
+    unsigned int VAO;
+    unsigned int VBO;
+    unsigned int EBO;
+    unsigned int instanceVBO;
+
+    unsigned int mode;
+    int indexCount;
+
+    void setupInstanceAttributes();
+public:
+    Mesh(const std::vector<float> &vertices, const std::vector<unsigned int> &indices, unsigned int mode, bool hasNormals, bool instanced);
+    ~Mesh();
+
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    int getIndexCount() const;
+
+    void bind() const;
+    void draw() const;
+    void drawInstanced(const InstanceData *instances, int count) const;
+};
+
+class MeshCache
+{
+private:
+    std::unique_ptr<Mesh> meshes[MESH_COUNT];
+
+    static Mesh *build(int primitive);
+    static void wireCubeGeometry(std::vector<float> &vertices, std::vector<unsigned int> &indices);
+public:
+    const Mesh &get(int primitive);
+    void clear();
+};
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * Note events sent as MIDI, to a sequencer port or a Standard MIDI File
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef MIDI_OUTPUT_H_
+#define MIDI_OUTPUT_H_
+
+#include <stk/RtMidi.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <NoteScheduler.h>
+#include <VoicePool.h>
+
+const int MIDI_FILE_DIVISION = 480;    // ticks per quarter note in written files
+const int MIDI_FILE_TEMPO    = 500000; // microseconds per quarter note in written files, 120 bpm
+
+// General MIDI program standing in for each bank's instrument, indexed by bank
+const unsigned char MIDI_PROGRAMS[VOICE_BANKS] = {40, 65, 24, 104, 6};
+
+struct MidiConfig {
+    std::string port = ""; // a port number to connect to, or the name of a virtual port to open
+    std::string file = ""; // Standard MIDI File to write what is played to
+};
+
+class MidiOutput
+{
+private:
+    std::unique_ptr<RtMidiOut> port;
+
+    std::string                path;
+    std::vector<unsigned char> track;      // file track events, written out on close
+    unsigned long long         trackTick = 0;
+
+    double sampleRate = 44100.0;
+
+    // note id of each sounding note to its channel and key, NOTE_OFF only carries the id
+    std::map<int, std::pair<unsigned char, unsigned char>> sounding;
+
+    // sounding notes on each channel and key, two notes can land on the same one and a
+    // note off for the first would cut the second short
+    int keys[VOICE_BANKS][128] = {};
+
+    std::vector<unsigned char> message;
+
+    void press(unsigned long long frame, unsigned char channel, unsigned char key, unsigned char level);
+    void release(unsigned long long frame, unsigned char channel, unsigned char key, unsigned char level);
+    void send(unsigned long long frame, unsigned char status, unsigned char data1, unsigned char data2);
+    bool writeFile() const;
+public:
+    MidiOutput() = default;
+
+    MidiOutput(const MidiOutput&) = delete;
+    MidiOutput &operator=(const MidiOutput&) = delete;
+
+    bool open(const MidiConfig &config, double rate);
+    void play(const NoteEvent &event);
+    bool close(unsigned long long frame);
+};
+
+#endif
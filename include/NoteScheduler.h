@@ -0,0 +1,50 @@
+/**
+ * Sample accurate note scheduling between the control thread and the audio callback
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef NOTE_SCHEDULER_H_
+#define NOTE_SCHEDULER_H_
+
+#include <stk/Stk.h>
+
+#include <atomic>
+
+#include <SpscQueue.h>
+#include <VoicePool.h>
+
+const int NOTE_ON         = 0;
+const int NOTE_OFF        = 1;
+const int NOTE_CHANGE     = 2; // glide a held note to a new frequency and velocity
+const int NOTE_HOLD       = 3; // NOTE_ON for a note held across steps, never stolen
+
+const int NOTE_QUEUE_SIZE = 512;
+
+struct NoteEvent {
+    unsigned long long time; // sample frame the event fires on
+    int                type;
+    int                note; // id pairing NOTE_CHANGEs and a NOTE_OFF with their NOTE_ON
+    int                bank; // instrument bank of a NOTE_ON or NOTE_HOLD
+    float              frequency;
+    float              velocity;
+};
+
+class NoteScheduler
+{
+private:
+    SpscQueue<NoteEvent, NOTE_QUEUE_SIZE> events;
+
+    // frames rendered so far, advanced by the audio callback only
+    std::atomic<unsigned long long> sampleTime {0};
+
+    static void fire(VoicePool &voices, const NoteEvent &event);
+public:
+    bool schedule(const NoteEvent &event);
+    unsigned long long getSampleTime() const;
+
+    void render(VoicePool &voices, stk::StkFloat *samples, unsigned int frames);
+};
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Render a list of note events to a WAV file, faster than real time
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef OFFLINE_RENDER_H_
+#define OFFLINE_RENDER_H_
+
+#include <stk/Stk.h>
+
+#include <string>
+#include <vector>
+
+#include <NoteScheduler.h>
+#include <VoicePool.h>
+
+const float OFFLINE_SEGMENT_SECONDS = 30.0f; // audio rendered by one thread at a time
+const int   OFFLINE_BLOCK_FRAMES    = 4096;
+const float OFFLINE_SETTLE_SECONDS  = 2.0f; // longest a held note renders ahead of a segment before it is restarted
+
+class OfflineRender
+{
+private:
+    std::vector<NoteEvent> events; // in time order
+
+    // per note id, when it starts and when it is released, ULLONG_MAX while held
+    std::vector<unsigned long long> noteStart;
+    std::vector<unsigned long long> noteEnd;
+
+    unsigned long long frames;
+    int                stealPolicy;
+
+    unsigned long long warmStart(unsigned long long start) const;
+    void renderSegment(VoicePool &voices, unsigned long long start, unsigned long long end, stk::StkFloat *output) const;
+public:
+    OfflineRender(const std::vector<NoteEvent> &noteEvents, unsigned long long length, int policy);
+
+    bool write(const std::string &path, unsigned int channels, int threads) const;
+};
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * Offscreen GL context and framebuffer for rendering without a display
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef OFFSCREEN_H_
+#define OFFSCREEN_H_
+
+#include <string>
+#include <vector>
+
+class Offscreen
+{
+private:
+    // EGLDisplay and EGLContext, kept opaque so EGL headers stay out of the rest of the build
+    void *display = nullptr;
+    void *context = nullptr;
+
+    unsigned int framebuffer  = 0;
+    unsigned int colourBuffer = 0;
+    unsigned int depthBuffer  = 0;
+
+    int width;
+    int height;
+
+    std::vector<unsigned char> pixels;
+
+    bool createContext();
+    bool createFramebuffer();
+public:
+    Offscreen(int width, int height);
+    ~Offscreen();
+
+    Offscreen(const Offscreen&) = delete;
+    Offscreen &operator=(const Offscreen&) = delete;
+
+    bool isValid() const;
+
+    int getWidth() const;
+    int getHeight() const;
+
+    void bind() const;
+    bool writeFrame(const std::string &path);
+};
+
+#endif
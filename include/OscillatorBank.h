@@ -0,0 +1,64 @@
+/**
+ * Bank of sine partials, one per sonified agent
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef OSCILLATOR_BANK_H_
+#define OSCILLATOR_BANK_H_
+
+#include <stk/Stk.h>
+
+#include <TripleBuffer.h>
+
+const int   OSCILLATOR_MAX   = 2048;
+const int   OSCILLATOR_LANES = 8;   // partials advanced together, one vector register of floats
+const int   OSCILLATOR_BLOCK = 256; // frames mixed per pass
+
+// partial targets written by the control thread
+struct PartialSet {
+    int   count = 0;
+    float frequency[OSCILLATOR_MAX];
+    float amplitude[OSCILLATOR_MAX];
+    float pan[OSCILLATOR_MAX]; // 0 left to 1 right
+};
+
+class OscillatorBank
+{
+private:
+    TripleBuffer<PartialSet> parameters;
+
+    // audio thread state, structure of arrays so each loop runs over contiguous floats
+    float real[OSCILLATOR_MAX];
+    float imaginary[OSCILLATOR_MAX];
+    float rotationReal[OSCILLATOR_MAX];
+    float rotationImaginary[OSCILLATOR_MAX];
+    float gainLeft[OSCILLATOR_MAX];
+    float gainRight[OSCILLATOR_MAX];
+    float targetLeft[OSCILLATOR_MAX];
+    float targetRight[OSCILLATOR_MAX];
+    float stepLeft[OSCILLATOR_MAX];
+    float stepRight[OSCILLATOR_MAX];
+
+    int count    = 0; // partials in the current set
+    int rendered = 0; // partials still sounding, includes ones fading out
+
+    float mixLeft[OSCILLATOR_BLOCK * OSCILLATOR_LANES];
+    float mixRight[OSCILLATOR_BLOCK * OSCILLATOR_LANES];
+
+    void apply(const PartialSet &partials);
+    void renderBlock(stk::StkFloat *output, unsigned int frames, unsigned int channels);
+public:
+    OscillatorBank();
+
+    OscillatorBank(const OscillatorBank&) = delete;
+    OscillatorBank &operator=(const OscillatorBank&) = delete;
+
+    PartialSet &write();
+    void publish();
+
+    void render(stk::StkFloat *output, unsigned int frames, unsigned int channels);
+};
+
+#endif
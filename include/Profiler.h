@@ -0,0 +1,76 @@
+/**
+ * In-app frame profiler, CPU time per phase and GPU time per draw pass
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+
+const int PROFILE_INPUT           = 0;
+const int PROFILE_UI              = 1;
+const int PROFILE_SIMULATION      = 2;
+const int PROFILE_MUSIC           = 3;
+// phases from here on are draw passes, timed on the GPU as well
+const int PROFILE_DRAW_SCENE      = 4;
+const int PROFILE_DRAW_AGENTS     = 5;
+const int PROFILE_DRAW_ATTRACTORS = 6;
+const int PROFILE_DRAW_IMPOSTORS  = 7;
+const int PROFILE_DRAW_UI         = 8;
+const int PROFILE_PHASES          = 9;
+
+const int PROFILE_FIRST_PASS      = PROFILE_DRAW_SCENE;
+const int PROFILE_HISTORY         = 120;
+const int PROFILE_QUERY_FRAMES    = 2;
+
+class Profiler
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point started[PROFILE_PHASES];
+    float cpuFrame[PROFILE_PHASES];
+
+    // timer queries are read back PROFILE_QUERY_FRAMES later so the CPU never waits on the GPU
+    unsigned int queries[PROFILE_QUERY_FRAMES][PROFILE_PHASES];
+    bool  issued[PROFILE_QUERY_FRAMES][PROFILE_PHASES];
+    int   queryFrame = 0;
+
+    float cpuHistory[PROFILE_PHASES][PROFILE_HISTORY];
+    float gpuHistory[PROFILE_PHASES][PROFILE_HISTORY];
+    int   historyIndex = 0;
+    int   historyCount = 0;
+
+    // percentiles sort a copy here, so reading them each frame doesn't allocate
+    mutable float scratch[PROFILE_HISTORY];
+
+    float percentile(const float *history, float fraction) const;
+public:
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler &operator=(const Profiler&) = delete;
+
+    void beginFrame();
+    void endFrame();
+
+    void begin(int phase);
+    void end(int phase);
+
+    int getHistoryCount() const;
+    int getHistoryOffset() const;
+
+    const float *getCpuHistory(int phase) const;
+    const float *getGpuHistory(int phase) const;
+
+    float getCpuPercentile(int phase, float fraction) const;
+    float getGpuPercentile(int phase, float fraction) const;
+
+    static const char *getPhaseName(int phase);
+};
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * Shared random number generation, one generator per thread
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <random>
+
+std::mt19937 &randomGenerator();
+
+void seedRandom(unsigned int seed);
+
+#endif
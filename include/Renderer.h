@@ -0,0 +1,54 @@
+/**
+ * Scene renderer shared by the window and the headless image mode
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef RENDERER_H_
+#define RENDERER_H_
+
+#include <glm/glm.hpp>
+#include <Shader.h>
+
+#include <Mesh.h>
+#include <Profiler.h>
+#include <Swarm.h>
+#include <UniformBuffer.h>
+
+class Renderer
+{
+private:
+    Shader shaderLight;
+    Shader shaderLightSource;
+    Shader shaderInstanced;
+    Shader shaderImpostor;
+
+    // every primitive is built once here and shared, adding attractors costs no GL allocation
+    MeshCache meshes;
+
+    // shared camera and light state, written once per frame (camera) or once at startup (lights)
+    UniformBuffer cameraBuffer;
+    UniformBuffer cubeLightBuffer;
+    UniformBuffer sceneLightBuffer;
+
+    glm::mat4 cubeModel;
+    glm::mat4 lightModel;
+
+    int lightSourceModelLocation;
+    int lightModelLocation;
+    int lightAmbientLocation;
+    int lightDiffuseLocation;
+    int lightSpecularLocation;
+    int lightShininessLocation;
+public:
+    Renderer();
+    ~Renderer();
+
+    Renderer(const Renderer&) = delete;
+    Renderer &operator=(const Renderer&) = delete;
+
+    void draw(Swarm &swarm, glm::vec3 cameraPosition, int width, int height, float detailDistance, Profiler &profiler);
+};
+
+#endif
@@ -0,0 +1,33 @@
+/**
+ * A control value that ramps linearly to its targets instead of jumping
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef SMOOTHED_PARAMETER_H_
+#define SMOOTHED_PARAMETER_H_
+
+class SmoothedParameter
+{
+private:
+    float value;
+    float target;
+    float step;       // change per frame while ramping
+    long  remaining;  // frames left in the ramp
+    long  rampFrames; // frames a whole ramp takes
+public:
+    SmoothedParameter();
+
+    void setRamp(long frames);
+    void setTarget(float newTarget);
+    void jump(float newValue);
+
+    bool advance(unsigned int frames);
+
+    float getValue() const;
+    float getTarget() const;
+    bool isMoving() const;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * Lock-free single producer, single consumer ring queue
+ *
+ * Storage is fixed at compile time, push and pop never allocate or block, which makes it
+ * safe to use from the audio callback
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    T items[Capacity];
+
+    // padded onto separate cache lines, each index is written by one side only (padding rather
+    // than alignas, which plain new does not honour before C++17)
+    char                     itemsPadding[64];
+    std::atomic<std::size_t> head {0}; // next to pop, written by the consumer
+    char                     headPadding[64];
+    std::atomic<std::size_t> tail {0}; // next to push, written by the producer
+public:
+    /**
+     * @param const T &item
+     * @return bool False if full
+     */
+    bool push(const T &item) {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        items[position & (Capacity - 1)] = item;
+        tail.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * @param T *item
+     * @return bool False if empty
+     */
+    bool pop(T *item) {
+        std::size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        *item = items[position & (Capacity - 1)];
+        head.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Look at the next item without consuming it, consumer only
+     *
+     * @return const T* NULL if empty
+     */
+    const T *peek() const {
+        std::size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+
+        return &items[position & (Capacity - 1)];
+    }
+
+    /**
+     * Drop the item returned by peek(), consumer only
+     *
+     * @return void
+     */
+    void discard() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    std::size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+};
+
+#endif
@@ -13,16 +13,44 @@
 
 #include <Agent.h>
 #include <Attractor.h>
+#include <Clusters.h>
+#include <Mesh.h>
+#include <SwarmAnalytics.h>
 #include <Triplet.h>
 
+const int SWARM_MOVE_SLICE = 128; // agents moved together on one thread, fixed so results don't depend on the core count
+
+// agents currently pulled by an attractor, with the attractor's note
+struct Occupancy {
+    int   pitch;
+    int   strength;
+    int   agents;
+    float meanDistance;
+};
+
 class Swarm
 {
 private:
     std::vector<Agent> agents;
     std::vector<Attractor> attractors;
 
+    std::vector<InstanceData> agentInstances;
+    std::vector<InstanceData> impostorInstances;
+    std::vector<InstanceData> attractorInstances;
+
+    Clusters       clusters;
+    SwarmAnalytics analytics;
+
+    std::vector<Occupancy> occupancy;
+
+    // stats and counts of each slice of the move loop, merged at the end of the step
+    std::vector<SwarmAnalytics>         sliceAnalytics;
+    std::vector<std::vector<Occupancy>> sliceOccupancy;
+
     Triplet averagePosition;
 
+    float time;
+
     float radiusRepulsion;
     float radiusOrientation;
     float radiusAttraction;
@@ -31,10 +59,16 @@ private:
     float speed;
     float maxForce;
     int swarmMode;
+
+    void moveSlices(int first, int stride, float deltaTime);
 public:
     Swarm();
 
     int getSize() const;
+    const std::vector<Agent> &getAgents() const;
+    const std::vector<Cluster> &getClusters() const;
+    const SwarmAnalytics &getAnalytics() const;
+    const std::vector<Occupancy> &getOccupancy() const;
     int getAttractorsCount() const;
 
     float getRepulsionRadius() const;
@@ -57,18 +91,19 @@ public:
     void setSwarmMode(int value);
 
     Triplet getAveragePosition() const;
+    float getTime() const;
 
     void addAgents();
-    void addAttractor(int pitch, unsigned int *VBO, unsigned int *EBO, unsigned int *VAO, int tone);
+    void addAttractor(int pitch, int tone);
 
     void resetAll();
     void resetAttractors();
 
     void swarm(float deltaTime);
-    void setupDrawAgents(unsigned int *VBO, unsigned int *normalVBO, unsigned int *EBO, unsigned int *VAO);
-    void setupDrawAttractors(unsigned int *VBO, unsigned int *EBO, unsigned int *VAO);
-    void drawAgents(Shader shader);
-    void drawAttractors(Shader shader);
+    void selectAgentDetail(glm::vec3 cameraPosition, float detailDistance, float pixelsPerUnit);
+    void drawAgents(const Shader &shader, const Mesh &mesh);
+    void drawAgentImpostors(const Shader &shader, const Mesh &mesh);
+    void drawAttractors(const Shader &shader, const Mesh &mesh);
 };
 
 #endif
@@ -0,0 +1,54 @@
+/**
+ * Order parameters and distributions of the swarm, gathered while it moves
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef SWARM_ANALYTICS_H_
+#define SWARM_ANALYTICS_H_
+
+#include <Agent.h>
+#include <Triplet.h>
+
+const int ANALYTICS_BINS = 16; // histogram bins per axis across the cube
+
+class SwarmAnalytics
+{
+private:
+    // running sums, in double so large swarms don't lose the small terms
+    long   count;
+    double reference[3]; // origin for the angular momentum, last step's centroid
+    double mean[3];
+    double squares[3];   // sum of squared deviations from the mean
+    double heading[3];   // sum of directions
+    double momentum[3];  // sum of (position - reference) x direction
+    int    histogram[3][ANALYTICS_BINS];
+    int    red;
+    int    blue;
+
+    // results of the last finished step
+    float   polarisation;
+    float   milling;
+    Triplet centroid;
+    Triplet variance;
+    float   redRatio;
+    int     bins[3][ANALYTICS_BINS];
+public:
+    SwarmAnalytics();
+
+    void begin();
+    void add(const Agent &agent);
+    void merge(const SwarmAnalytics &other);
+    void end();
+
+    float getPolarisation() const;
+    float getMilling() const;
+    Triplet getCentroid() const;
+    Triplet getVariance() const;
+    float getSpread() const;
+    float getRedRatio() const;
+    const int *getHistogram(int axis) const;
+};
+
+#endif
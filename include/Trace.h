@@ -0,0 +1,72 @@
+/**
+ * Scoped trace zones written out as Chrome trace JSON (chrome://tracing, Perfetto)
+ *
+ * Zones compile to nothing unless SWARM_TRACE is defined
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+const int TRACE_BUFFER_EVENTS = 1 << 16; // most recent events kept per thread, about a minute of frames
+
+struct TraceEvent {
+    const char *name;
+    int64_t     begin; // microseconds since start
+    int64_t     duration;
+};
+
+// a ring written only by its own thread, the newest event overwriting the oldest, and read by
+// the exporter up to the published count
+struct TraceBuffer {
+    std::string          threadName;
+    int                  threadId;
+    std::atomic<int64_t> count; // events ever recorded, the last TRACE_BUFFER_EVENTS of them kept
+    TraceEvent           events[TRACE_BUFFER_EVENTS];
+};
+
+class Trace
+{
+public:
+    static int64_t now();
+
+    static void record(const char *name, int64_t begin, int64_t end);
+    static void setThreadName(const char *name);
+
+    static bool write(const char *path);
+};
+
+class TraceScope
+{
+private:
+    const char *name;
+    int64_t     begin;
+public:
+    TraceScope(const char *name) : name(name), begin(Trace::now()) {}
+    ~TraceScope() { Trace::record(name, begin, Trace::now()); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope &operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef SWARM_TRACE
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD(name) Trace::setThreadName(name)
+#define TRACE_WRITE(path) Trace::write(path)
+#else
+#define TRACE_SCOPE(name) ((void) 0)
+#define TRACE_THREAD(name) ((void) 0)
+#define TRACE_WRITE(path) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * Lock-free triple buffer handing the latest value from one producer to one consumer
+ *
+ * The producer always has a buffer to write and the consumer always has a complete one to
+ * read, neither ever waits. Values the consumer has not picked up are overwritten
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    T buffers[3];
+
+    std::atomic<int> middle {1}; // index of the spare buffer, FRESH once published
+    int back  = 0;               // producer's buffer
+    int front = 2;               // consumer's buffer
+public:
+    /**
+     * Buffer to fill before publish(), producer only
+     *
+     * @return T&
+     */
+    T &write() {
+        return buffers[back];
+    }
+
+    /**
+     * Make the written buffer the latest value, producer only
+     *
+     * @return void
+     */
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /**
+     * Pick up the latest published value if there is one, consumer only
+     *
+     * @return bool Whether read() changed
+     */
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+
+        return true;
+    }
+
+    /**
+     * @return const T& Latest value picked up by update(), consumer only
+     */
+    const T &read() const {
+        return buffers[front];
+    }
+};
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * A std140 uniform buffer object shared between shader programs
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef UNIFORM_BUFFER_H_
+#define UNIFORM_BUFFER_H_
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+const unsigned int CAMERA_BINDING = 0;
+const unsigned int LIGHT_BINDING  = 1;
+
+// matches the std140 "Camera" block in the shaders
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 normalMatrix; // only the upper 3x3 is used
+};
+
+// matches the std140 "Light" block in the shaders
+struct LightBlock {
+    glm::vec4 position;
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+};
+
+class UniformBuffer
+{
+private:
+    unsigned int id;
+    unsigned int binding;
+    std::size_t  size;
+
+public:
+    UniformBuffer(std::size_t size, unsigned int binding);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    unsigned int getId() const;
+    unsigned int getBinding() const;
+
+    void bind() const;
+    void update(const void *data, std::size_t length, std::size_t offset = 0) const;
+
+    template <typename T>
+    void update(const T &data) const {
+        update(&data, sizeof(T));
+    }
+};
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * Fixed pool of preallocated instrument voices with voice stealing
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#ifndef VOICE_POOL_H_
+#define VOICE_POOL_H_
+
+#include <stk/Instrmnt.h>
+
+#include <atomic>
+#include <memory>
+
+#include <SmoothedParameter.h>
+
+const int   BANK_BOWED             = 0;
+const int   BANK_SAXOFONY          = 1;
+const int   BANK_PLUCKED           = 2;
+const int   BANK_SITAR             = 3;
+const int   BANK_STIFKARP          = 4;
+const int   VOICE_BANKS            = 5;
+
+const int   VOICE_COUNT            = 8; // per bank
+const int   VOICE_STEAL_OLDEST     = 0;
+const int   VOICE_STEAL_QUIETEST   = 1;
+
+const float VOICE_LOWEST_FREQUENCY = 100.0f;
+const float VOICE_RELEASE          = 1.0f; // seconds a released voice keeps sounding
+const float VOICE_GAIN             = 0.5f;
+const int   VOICE_BLOCK_FRAMES     = 1024; // largest block rendered in one go, longer ones are split
+const float VOICE_GLIDE            = 0.08f; // seconds a held note takes to reach a new frequency
+const float VOICE_GAIN_RAMP        = 0.01f; // seconds a held note takes to reach a new velocity
+const int   VOICE_CONTROL_FRAMES   = 64; // frames between instrument frequency updates while gliding
+
+struct Voice {
+    std::unique_ptr<stk::Instrmnt> instrument;
+
+    bool               active   = false;
+    int                note     = -1;    // note holding the voice, -1 once released
+    unsigned long long started  = 0;
+    long               release  = 0;     // frames left to sound once released
+    stk::StkFloat      level    = 0.0;   // peak of the last rendered buffer
+    float              velocity = 1.0f;  // velocity the note started with
+    bool               held     = false; // held across steps, only stolen when nothing else is left
+
+    SmoothedParameter  frequency;
+    SmoothedParameter  gain;             // relative to the starting velocity
+};
+
+class VoicePool
+{
+private:
+    Voice voices[VOICE_BANKS][VOICE_COUNT];
+
+    std::atomic<int> stealPolicy;
+    long             releaseLength;
+
+    // scratch block for one voice, sized once so resizing down never allocates
+    stk::StkFrames   block;
+
+    static stk::Instrmnt *createInstrument(int bank);
+
+    Voice *allocate(int bank);
+
+    void renderBlock(stk::StkFloat *samples, unsigned int frames);
+public:
+    VoicePool();
+
+    VoicePool(const VoicePool&) = delete;
+    VoicePool &operator=(const VoicePool&) = delete;
+
+    int getStealPolicy() const;
+    void setStealPolicy(int value);
+
+    void noteOn(int bank, int note, float frequency, float velocity, unsigned long long time, bool hold);
+    void noteOff(int note, float velocity);
+    void noteChange(int note, float frequency, float velocity);
+
+    void render(stk::StkFloat *samples, unsigned int frames);
+
+    int getActiveCount() const;
+};
+
+#endif
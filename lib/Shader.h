@@ -9,16 +9,139 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <sys/stat.h>
+
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
+
+// linked programs are cached here by source hash, skipping compilation on later starts
+#define SHADER_CACHE_DIR "./shaders/cache"
 
 class Shader
 {
 private:
     unsigned int id;
 
+    // uniform locations resolved once after linking, looked up by name without allocating
+    std::vector<std::pair<std::string, int>> uniformLocations;
+
+    void cacheUniformLocations() {
+        int count = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+
+        uniformLocations.clear();
+        uniformLocations.reserve(count);
+
+        char name[256];
+        for (int i = 0; i < count; ++i) {
+            int length, size;
+            GLenum type;
+            glGetActiveUniform(id, i, sizeof(name), &length, &size, &type, name);
+
+            // members of uniform blocks have no location
+            int location = glGetUniformLocation(id, name);
+            if (location < 0) {
+                continue;
+            }
+
+            uniformLocations.emplace_back(std::string(name, length), location);
+        }
+    }
+
+    // FNV-1a over both sources and the driver, a driver update invalidates every binary
+    static std::string cachePath(const std::string &vertexCode, const std::string &fragmentCode) {
+        unsigned long long hash = 14695981039346656037ULL;
+
+        const char *driver[] = {
+            (const char *) glGetString(GL_VENDOR),
+            (const char *) glGetString(GL_RENDERER),
+            (const char *) glGetString(GL_VERSION)
+        };
+
+        std::string key = vertexCode + '\0' + fragmentCode;
+        for (const char *part : driver) {
+            key += '\0';
+            key += part != NULL ? part : "";
+        }
+
+        for (unsigned char c : key) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+
+        std::stringstream path;
+        path << SHADER_CACHE_DIR << "/" << std::hex << hash << ".bin";
+
+        return path.str();
+    }
+
+    static bool canCacheBinaries() {
+        int formats = 0;
+        if (GLAD_GL_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+
+        return formats > 0;
+    }
+
+    bool loadBinary(const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+
+        GLenum format;
+        if (!file.read((char *) &format, sizeof(format))) {
+            return false;
+        }
+
+        std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (binary.empty()) {
+            return false;
+        }
+
+        id = glCreateProgram();
+        glProgramBinary(id, format, binary.data(), binary.size());
+
+        // rejected binaries (driver changed underneath) fall back to compiling
+        int success;
+        glGetProgramiv(id, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(id);
+            return false;
+        }
+
+        return true;
+    }
+
+    void saveBinary(const std::string &path) const {
+        int length = 0;
+        glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        GLenum format;
+        std::vector<char> binary(length);
+        glGetProgramBinary(id, length, NULL, &format, binary.data());
+
+        mkdir(SHADER_CACHE_DIR, 0755);
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            return;
+        }
+
+        file.write((const char *) &format, sizeof(format));
+        file.write(binary.data(), binary.size());
+    }
+
     void checkErrors(unsigned int shader, std::string type) {
         int success;
         char infoLog[1024];
@@ -45,6 +168,7 @@ public:
 
     void setId(unsigned int value) {
         id = value;
+        cacheUniformLocations();
     }
 
     Shader(const char* vertexPath, const char* fragmentPath) {
@@ -74,6 +198,18 @@ public:
             std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
         }
 
+        bool cached = canCacheBinaries();
+        std::string binaryPath;
+
+        if (cached) {
+            binaryPath = cachePath(vertexCode, fragmentCode);
+
+            if (loadBinary(binaryPath)) {
+                cacheUniformLocations();
+                return;
+            }
+        }
+
         const char* vertexShaderCode   = vertexCode.c_str();
         const char* fragmentShaderCode = fragmentCode.c_str();
 
@@ -94,32 +230,76 @@ public:
         id = glCreateProgram();
         glAttachShader(id, vertex);
         glAttachShader(id, fragment);
+        if (cached) {
+            glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glLinkProgram(id);
         checkErrors(id, "PROGRAM");
 
+        int success;
+        glGetProgramiv(id, GL_LINK_STATUS, &success);
+        if (cached && success) {
+            saveBinary(binaryPath);
+        }
+
         // delete shaders
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+
+        cacheUniformLocations();
     }
 
     void use() {
         glUseProgram(id);
     }
 
-    void setBool(const std::string &name, bool value) const {
-        glUniform1i(glGetUniformLocation(id, name.c_str()), (int)value);
+    int getUniformLocation(const char *name) const {
+        for (const std::pair<std::string, int> &uniform : uniformLocations) {
+            if (std::strcmp(uniform.first.c_str(), name) == 0) {
+                return uniform.second;
+            }
+        }
+
+        return -1;
+    }
+
+    void bindUniformBlock(const char *name, unsigned int bindingPoint) const {
+        unsigned int index = glGetUniformBlockIndex(id, name);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(id, index, bindingPoint);
+        }
+    }
+
+    void setBool(int location, bool value) const {
+        glUniform1i(location, (int)value);
+    }
+    void setInt(int location, int value) const {
+        glUniform1i(location, value);
+    }
+    void setFloat(int location, float value) const {
+        glUniform1f(location, value);
+    }
+    void setMat4(int location, const glm::mat4 &value) const {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+    void setVec3(int location, const glm::vec3 &value) const {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+
+    void setBool(const char *name, bool value) const {
+        setBool(getUniformLocation(name), value);
     }
-    void setInt(const std::string &name, int value) const {
-        glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+    void setInt(const char *name, int value) const {
+        setInt(getUniformLocation(name), value);
     }
-    void setFloat(const std::string &name, float value) const {
-        glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+    void setFloat(const char *name, float value) const {
+        setFloat(getUniformLocation(name), value);
     }
-    void setMat4(const std::string &name, glm::mat4 value) const {
-        glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    void setMat4(const char *name, const glm::mat4 &value) const {
+        setMat4(getUniformLocation(name), value);
     }
-    void setVec3(const std::string &name, glm::vec3 value) const {
-        glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, glm::value_ptr(value));
+    void setVec3(const char *name, const glm::vec3 &value) const {
+        setVec3(getUniformLocation(name), value);
     }
 };
 
@@ -0,0 +1,31 @@
+#version 330 core
+out vec4 FragColour;
+
+in vec3 colour;
+in vec2 axis;
+
+layout (std140) uniform Light {
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+} light;
+
+void main() {
+    // sprite coordinates in -1..1 with y up, split along and across the projected cone axis
+    vec2  point  = vec2(gl_PointCoord.x, 1.0 - gl_PointCoord.y) * 2.0 - 1.0;
+    float along  = dot(point, axis);
+    float across = dot(point, vec2(-axis.y, axis.x));
+
+    // cone silhouette, apex at along = 1 and base at along = -1
+    float halfWidth = 0.25 * (1.0 - along);
+    if (along < -1.0 || abs(across) > halfWidth) {
+        discard;
+    }
+
+    // shade across the cone as if it were round
+    float diff = 1.0 - abs(across) / max(halfWidth, 0.0001);
+
+    vec3 result = light.ambient.rgb * colour + light.diffuse.rgb * (0.5 * diff * colour);
+    FragColour  = vec4(result, 1.0);
+}
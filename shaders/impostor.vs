@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3  aPos;
+layout (location = 2) in mat4  aModel;
+layout (location = 6) in vec3  aFromColour;
+layout (location = 7) in vec3  aToColour;
+layout (location = 8) in float aChangeTime;
+
+out vec3 colour;
+out vec2 axis;
+
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 normalMatrix;
+};
+
+uniform float time;
+uniform float fadeTime;
+uniform float agentSize;
+uniform float pixelsPerUnit;
+
+void main() {
+    vec4 viewPos = view * aModel * vec4(aPos, 1.0);
+
+    gl_Position  = projection * viewPos;
+    gl_PointSize = clamp(agentSize * pixelsPerUnit / max(-viewPos.z, 1.0), 1.0, 64.0);
+
+    // the cone points along the model's y axis, project it to orient the sprite
+    vec3 direction = mat3(view) * aModel[1].xyz;
+    axis           = length(direction.xy) > 0.0001 ? normalize(direction.xy) : vec2(0.0, 1.0);
+
+    colour = mix(aFromColour, aToColour, clamp((time - aChangeTime) / fadeTime, 0.0, 1.0));
+}
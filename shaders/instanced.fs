@@ -0,0 +1,41 @@
+#version 330 core
+struct Material {
+    vec3  specular;
+    float shininess;
+};
+
+out vec4 FragColour;
+
+in vec3 fragPos;
+in vec3 normal;
+in vec3 LightPos;
+in vec3 colour;
+
+layout (std140) uniform Light {
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+} light;
+
+uniform Material material;
+
+void main() {
+    // ambient
+    vec3 ambient = light.ambient.rgb * colour;
+
+    // diffuse
+    vec3  norm     = normalize(normal);
+    vec3  lightDir = normalize(LightPos - fragPos);
+    float diff     = max(dot(norm, lightDir), 0.0);
+    vec3  diffuse  = light.diffuse.rgb * (diff * colour);
+
+    // specular
+    vec3  viewDir    = normalize(-fragPos);
+    vec3  reflectDir = reflect(-lightDir, norm);
+    float spec       = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3  specular   = light.specular.rgb * (spec * material.specular);
+
+    vec3 result  = ambient + diffuse + specular;
+    FragColour   = vec4(result, 1.0);
+}
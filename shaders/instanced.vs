@@ -0,0 +1,41 @@
+#version 330 core
+layout (location = 0) in vec3  aPos;
+layout (location = 1) in vec3  aNormal;
+layout (location = 2) in mat4  aModel;
+layout (location = 6) in vec3  aFromColour;
+layout (location = 7) in vec3  aToColour;
+layout (location = 8) in float aChangeTime;
+
+out vec3 fragPos;
+out vec3 normal;
+out vec3 LightPos;
+out vec3 colour;
+
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 normalMatrix;
+};
+
+layout (std140) uniform Light {
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+} light;
+
+uniform float time;
+uniform float fadeTime;
+
+void main() {
+    vec4 viewPos = view * aModel * vec4(aPos, 1.0);
+
+    gl_Position = projection * viewPos;
+    fragPos     = vec3(viewPos);
+
+    // instances are only translated, rotated and uniformly scaled (see light.vs)
+    normal      = mat3(normalMatrix) * (mat3(aModel) * aNormal);
+    LightPos    = vec3(view * light.position);
+
+    colour      = mix(aFromColour, aToColour, clamp((time - aChangeTime) / fadeTime, 0.0, 1.0));
+}
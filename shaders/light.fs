@@ -6,38 +6,36 @@ struct Material {
     float shininess;
 };
 
-struct Light {
-    vec3 position;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
 out vec4 FragColour;
 
 in vec3 fragPos;
 in vec3 normal;
 in vec3 LightPos;
 
-uniform Light light;
+layout (std140) uniform Light {
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+} light;
+
 uniform Material material;
 
 void main() {
     // ambient
-    vec3 ambient = light.ambient * material.ambient;
+    vec3 ambient = light.ambient.rgb * material.ambient;
 
     // diffuse
     vec3  norm     = normalize(normal);
     vec3  lightDir = normalize(LightPos - fragPos);
     float diff     = max(dot(norm, lightDir), 0.0);
-    vec3  diffuse  = light.diffuse * (diff * material.diffuse);
+    vec3  diffuse  = light.diffuse.rgb * (diff * material.diffuse);
 
     // specular
     vec3  viewDir    = normalize(-fragPos);
     vec3  reflectDir = reflect(-lightDir, norm);
     float spec       = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3  specular   = light.specular * (spec * material.specular);
+    vec3  specular   = light.specular.rgb * (spec * material.specular);
 
     vec3 result  = ambient + diffuse + specular;
     FragColour   = vec4(result, 1.0);
@@ -6,15 +6,29 @@ out vec3 fragPos;
 out vec3 normal;
 out vec3 LightPos;
 
-uniform vec3 lightPos;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 normalMatrix;
+};
+
+layout (std140) uniform Light {
+    vec4 position;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+} light;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    fragPos     = vec3(view* model * vec4(aPos, 1.0));
-    normal      = mat3(transpose(inverse(view * model))) * aNormal;
-    LightPos    = vec3(view * vec4(lightPos, 1.0));
+    vec4 viewPos = view * model * vec4(aPos, 1.0);
+
+    gl_Position = projection * viewPos;
+    fragPos     = vec3(viewPos);
+
+    // models are only ever translated, rotated and uniformly scaled, so the rotation part
+    // of the model is its own normal matrix up to scale (normalised in the fragment shader)
+    normal      = mat3(normalMatrix) * (mat3(model) * aNormal);
+    LightPos    = vec3(view * light.position);
 }
@@ -4,9 +4,13 @@ layout (location = 1) in vec3 aCol;
 
 out vec3 colour;
 
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 normalMatrix;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
@@ -14,11 +14,11 @@
 
 #include <cmath>
 #include <iostream>
-#include <random>
 #include <vector>
 
 #include <Agent.h>
 #include <Attractor.h>
+#include <Random.h>
 #include <Triplet.h>
 
 const float TO_DEGREES   = 57.295779524;
@@ -36,11 +36,9 @@ const float PI           = 3.14159265;
  * @return float
  */
 float agentRand() {
-    std::random_device randomDevice;
-    std::mt19937 generator(randomDevice());
     std::uniform_int_distribution<> distribution(0, CUBE_HALF_SIZE * 2);
 
-    return (float) distribution(generator);
+    return (float) distribution(randomGenerator());
 }
 
 Agent::Agent() {
@@ -59,6 +57,10 @@ Agent::Agent() {
     return this->position;
 }
 
+Triplet Agent::getDirection() const {
+    return this->direction;
+}
+
 Triplet Agent::getColour() const {
     return this->colour;
 }
@@ -67,32 +69,34 @@ Triplet Agent::getOldColour() const {
     return this->oldColour;
 }
 
-void Agent::setOldColour(Triplet value) {
-    oldColour = value;
-}
-
-int Agent::getColourSwapTime() const {
-    return this->colourSwapTime;
-}
-
-void Agent::setColourSwapTime(int value) {
-    colourSwapTime = value;
+float Agent::getColourChangeTime() const {
+    return this->colourChangeTime;
 }
 
 /**
  * Change colour of an agent if orientation area neighbours are mostly of the other colour
  *
+ * A new change is only taken once the previous fade has finished
+ *
  * @param int colourCount Positive (+) value for blue, negative (-) for red
+ * @param float time Simulation time in seconds
  * @return void
  */
-void Agent::setColour(int colourCount) {
+void Agent::setColour(int colourCount, float time) {
     if (colourCount == 0) {
         return;
     }
 
-    if (colourSwapTime == 0) {
-        oldColour = colour;
-        colour    = colourCount > 0 ? BLUE : RED;
+    if (time - colourChangeTime < COLOUR_FADE_TIME) {
+        return;
+    }
+
+    Triplet newColour = colourCount > 0 ? BLUE : RED;
+
+    if (newColour.getX() != colour.getX()) {
+        oldColour        = colour;
+        colour           = newColour;
+        colourChangeTime = time;
     }
 }
 
@@ -159,13 +163,15 @@ Triplet Agent::repulsion(
  * @param float radiusOrientation
  * @param float blindAngle
  * @param float maxForce
+ * @param float time
  */
 Triplet Agent::orientation(
     std::vector<Agent> &agents,
     float radiusRepulsion,
     float radiusOrientation,
     float blindAngle,
-    float maxForce
+    float maxForce,
+    float time
 ) {
     Triplet newDirection(0.0, 0.0, 0.0);
     int count       = 0;
@@ -199,7 +205,7 @@ Triplet Agent::orientation(
         computeChange(newDirection, (float) count, direction, maxForce);
     }
 
-    setColour(colourCount);
+    setColour(colourCount, time);
 
     return newDirection;
 }
@@ -280,111 +286,69 @@ Triplet Agent::bounding() const {
 }
 
 /**
- * Setup an agent to be drawn
+ * Cone geometry for an agent, interleaved positions and normals
  *
- * @param unsigned int *VBO
- * @param unsigned int *normalVBO
- * @param unsigned int *EBO
- * @param unsigned int *VAO
+ * @param std::vector<float> &vertices
+ * @param std::vector<unsigned int> &indices
  *
  * @return void
  */
-void Agent::setupDraw(unsigned int *VBO, unsigned int *normalVBO, unsigned int *EBO, unsigned int *VAO) {
+void Agent::geometry(std::vector<float> &vertices, std::vector<unsigned int> &indices) {
     // cone vertices
     int points = 10;
 
     float angle     = 0.0f;
     float increment = glm::radians(360.0f) / (float) points;
 
-    std::vector<float> vertices;
+    std::vector<glm::vec3> positions;
 
     // bottom circle vertices
     for (int i = 0; i < points; ++i) {
-        vertices.push_back(cos(angle) * 0.1);
-        vertices.push_back(-0.2f);
-        vertices.push_back(sin(angle) * 0.1);
+        positions.push_back(glm::vec3(cos(angle) * 0.1, -0.2f, sin(angle) * 0.1));
         angle += increment;
     }
 
     // top vertex
-    vertices.push_back(0.0f);
-    vertices.push_back(0.3f);
-    vertices.push_back(0.0f);
+    positions.push_back(glm::vec3(0.0f, 0.3f, 0.0f));
 
     // bottom vertex
-    vertices.push_back(0.0f);
-    vertices.push_back(-0.2f);
-    vertices.push_back(0.0f);
-
-    unsigned int indices[] = {
-        10,  0, 1,
-        10,  1, 2,
-        10,  2, 3,
-        10,  3, 4,
-        10,  4, 5,
-        10,  5, 6,
-        10,  6, 7,
-        10,  7, 8,
-        10,  8, 9,
-        10,  9, 0,
-        11,  0, 1,
-        11,  1, 2,
-        11,  2, 3,
-        11,  3, 4,
-        11,  4, 5,
-        11,  5, 6,
-        11,  6, 7,
-        11,  7, 8,
-        11,  8, 9,
-        11,  9, 0
-    };
-
-    std::vector<float> normals;
+    positions.push_back(glm::vec3(0.0f, -0.2f, 0.0f));
 
+    // sides fan out from the top vertex, the base from the bottom one
+    indices.clear();
     for (int i = 0; i < points; ++i) {
-        int index = i * 3;
-        glm::vec3 a(vertices.at(index), vertices.at(index + 1), vertices.at(index + 2));
-
-        index = (i + 1) * 3;
-        if (i == 9) {
-            index = 0;
-        }
-        glm::vec3 b(vertices.at(index), vertices.at(index + 1), vertices.at(index + 2));
-        glm::vec3 crossProduct = glm::cross(glm::normalize(b), glm::normalize(a));
-        normals.push_back(crossProduct.x);
-        normals.push_back(crossProduct.y);
-        normals.push_back(crossProduct.z);
+        indices.push_back(points);
+        indices.push_back(i);
+        indices.push_back((i + 1) % points);
     }
 
     for (int i = 0; i < points; ++i) {
-        normals.push_back(0.0f);
-        normals.push_back(-1.0f);
-        normals.push_back(0.0f);
+        indices.push_back(points + 1);
+        indices.push_back(i);
+        indices.push_back((i + 1) % points);
     }
 
-    glGenBuffers(1, VBO);
-    glGenBuffers(1, normalVBO);
-    glGenBuffers(1, EBO);
-    glGenVertexArrays(1, VAO);
+    std::vector<glm::vec3> normals;
 
-    glBindVertexArray(*VAO);
-
-    // vertices
-    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
-    glEnableVertexAttribArray(0);
-
-    // normals
-    glBindBuffer(GL_ARRAY_BUFFER, *normalVBO);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
+    for (int i = 0; i < points; ++i) {
+        glm::vec3 a = positions.at(i);
+        glm::vec3 b = positions.at((i + 1) % points);
+        normals.push_back(glm::cross(glm::normalize(b), glm::normalize(a)));
+    }
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
-    glEnableVertexAttribArray(1);
+    // top and bottom vertices
+    normals.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+    normals.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+
+    vertices.clear();
+    for (std::size_t i = 0, size = positions.size(); i < size; ++i) {
+        vertices.push_back(positions.at(i).x);
+        vertices.push_back(positions.at(i).y);
+        vertices.push_back(positions.at(i).z);
+        vertices.push_back(normals.at(i).x);
+        vertices.push_back(normals.at(i).y);
+        vertices.push_back(normals.at(i).z);
+    }
 }
 
 glm::quat Agent::rotationBetweenVectors(glm::vec3 start, glm::vec3 dest) {
@@ -418,7 +382,7 @@ glm::quat Agent::rotationBetweenVectors(glm::vec3 start, glm::vec3 dest) {
  * @param glm::mat4 *agentModel
  * @return void
  */
-void Agent::transform(glm::mat4 *agentModel) {
+void Agent::transform(glm::mat4 *agentModel) const {
     glm::vec3 start = glm::vec3(0.0f, 1.0f, 0.0f);
     glm::vec3 dest  = glm::vec3(direction.getX(), direction.getY(), direction.getZ());
 
@@ -431,23 +395,34 @@ void Agent::transform(glm::mat4 *agentModel) {
 }
 
 /**
- * Draw an agent
+ * Fill the per-instance draw data of this agent
  *
+ * Reads the agent only, the colour blend between old and new colour happens in the shader
+ *
+ * @param InstanceData *agentInstance
  * @return void
  */
-void Agent::draw() {
-    glDrawElements(GL_TRIANGLE_FAN, 30, GL_UNSIGNED_INT, 0);
-    glDrawElements(GL_TRIANGLE_FAN, 30, GL_UNSIGNED_INT, (void*) (30 * sizeof(float)));
+void Agent::instance(InstanceData *agentInstance) const {
+    agentInstance->model = glm::mat4(1.0f);
+    transform(&agentInstance->model);
+
+    agentInstance->fromColour = glm::vec3(oldColour.getX(), oldColour.getY(), oldColour.getZ());
+    agentInstance->toColour   = glm::vec3(colour.getX(), colour.getY(), colour.getZ());
+    agentInstance->changeTime = colourChangeTime;
 }
 
 /**
  * Move agent
  *
  * @param float speed
- * @param std::vector<Attractor> attractors
- * @return void
+ * @param const std::vector<Attractor> &attractors
+ * @param float deltaTime
+ * @param float *attractorDistance Distance to the attractor pulling the agent
+ * @return int Index of the attractor pulling the agent, -1 without attractors
  */
-void Agent::move(float speed, std::vector<Attractor> attractors, float deltaTime) {
+int Agent::move(float speed, const std::vector<Attractor> &attractors, float deltaTime, float *attractorDistance) {
+    int attractor = -1;
+
     if (attractors.size() != 0) {
         float  minDistance = MIN_DISTANCE;
         size_t index       = 0;
@@ -463,6 +438,9 @@ void Agent::move(float speed, std::vector<Attractor> attractors, float deltaTime
         Triplet newTmp = attractors.at(index).getPosition() - position;
         newTmp.scalarMul(0.0005);
         acceleration = acceleration + newTmp;
+
+        attractor          = index;
+        *attractorDistance = minDistance;
     }
 
     direction = direction + acceleration;
@@ -475,6 +453,8 @@ void Agent::move(float speed, std::vector<Attractor> attractors, float deltaTime
 
     // reset acceleration
     acceleration.scalarMul(0);
+
+    return attractor;
 }
 
 /**
@@ -486,6 +466,7 @@ void Agent::move(float speed, std::vector<Attractor> attractors, float deltaTime
  * @param float radiusAttraction
  * @param float angle
  * @param float maxForce
+ * @param float time
  */
 void Agent::step(
     std::vector<Agent> &agents,
@@ -493,7 +474,8 @@ void Agent::step(
     float radiusOrientation,
     float radiusAttraction,
     float angle,
-    float maxForce
+    float maxForce,
+    float time
 ) {
     // calculate repulsion first as this is the priority
     Triplet repulsionVector = repulsion(agents, radiusRepulsion, angle, maxForce);
@@ -505,7 +487,7 @@ void Agent::step(
     }
 
     // otherwise we can seek others, stay in course or both
-    Triplet orientationVector = orientation(agents, radiusRepulsion, radiusOrientation, angle, maxForce);
+    Triplet orientationVector = orientation(agents, radiusRepulsion, radiusOrientation, angle, maxForce, time);
     orientationVector.scalarMul(2.5); // For smoother movement
 
     Triplet attractionVector  = attraction(agents, radiusOrientation, radiusAttraction, angle, maxForce);
@@ -11,10 +11,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <cmath>
-#include <random>
 #include <vector>
 
 #include <Attractor.h>
+#include <Random.h>
 #include <Triplet.h>
 
 #include <iostream>
@@ -40,22 +40,21 @@ const float PI             = 3.14159265;
  * @return float
  */
 float attractRand() {
-    std::random_device randomDevice;
-    std::mt19937 generator(randomDevice());
     std::uniform_int_distribution<> distribution(0, 800);
 
-    return (float) distribution(generator);
+    return (float) distribution(randomGenerator());
 }
 
-Attractor::Attractor(int pitch, int givenTone) : position(initPosition(pitch)) {
-    tone = givenTone;
+Attractor::Attractor(int givenPitch, int givenTone) : position(initPosition(givenPitch)) {
+    pitch = givenPitch;
+    tone  = givenTone;
     mode = SCALES;
 
     if (tone == I || tone == V) {
         strength = 3;
     } else if (tone == ii || tone == IV || tone == vii) {
         strength = 2;
-    } else if (tone == iii || tone == vi || tone == -1) {
+    } else {
         strength = 1;
     }
 
@@ -81,16 +80,32 @@ Triplet Attractor::getColour() const {
     return this->colour;
 }
 
+int Attractor::getPitch() const {
+    return this->pitch;
+}
+
+int Attractor::getTone() const {
+    return this->tone;
+}
+
 /**
- * Setup sphere drawing
+ * Harmonic weight of the attractor's scale degree, 3 for I and V down to 1
  *
- * @param unsigned int *VBO
- * @param unsigned int *EBO
- * @param unsigned int *VAO
+ * @return int
+ */
+int Attractor::getStrength() const {
+    return this->strength;
+}
+
+/**
+ * Sphere geometry for an attractor, interleaved positions and normals
+ *
+ * @param std::vector<float> &vertices
+ * @param std::vector<unsigned int> &indices
  * @return void
  */
-void Attractor::setupDraw(unsigned int *VBO, unsigned int *EBO, unsigned int *VAO) {
-    std::vector<float> vertices;
+void Attractor::geometry(std::vector<float> &vertices, std::vector<unsigned int> &indices) {
+    vertices.clear();
 
     for (int i = 0; i <= 25; ++i) {
         float stackAngle = (PI / 2) - (i * (PI / 25));
@@ -114,7 +129,7 @@ void Attractor::setupDraw(unsigned int *VBO, unsigned int *EBO, unsigned int *VA
         }
     }
 
-    std::vector<int> indices;
+    indices.clear();
 
     for (int i = 0; i < 25; ++i) {
         int k1 = i * 26;
@@ -134,25 +149,6 @@ void Attractor::setupDraw(unsigned int *VBO, unsigned int *EBO, unsigned int *VA
             }
         }
     }
-
-    glGenBuffers(1, VBO);
-    glGenBuffers(1, EBO);
-    glGenVertexArrays(1, VAO);
-
-    glBindVertexArray(*VAO);
-
-    // vertices and normals
-    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), indices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*) 0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*) (3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
 }
 
 /**
@@ -161,16 +157,23 @@ void Attractor::setupDraw(unsigned int *VBO, unsigned int *EBO, unsigned int *VA
  * @param glm::mat4 *attractorModel
  * @return void
  */
-void Attractor::transform(glm::mat4 *attractorModel) {
+void Attractor::transform(glm::mat4 *attractorModel) const {
     *attractorModel = glm::translate(*attractorModel, glm::vec3(position.getX(), position.getY(), position.getZ()));
     *attractorModel = glm::scale(*attractorModel, glm::vec3(5.0f, 5.0f, 5.0f));
 }
 
 /**
- * Draw attractor
+ * Fill the per-instance draw data of this attractor
  *
+ * @param InstanceData *attractorInstance
  * @return void
  */
-void Attractor::draw() {
-    glDrawElements(GL_TRIANGLES, 3600, GL_UNSIGNED_INT, 0);
+void Attractor::instance(InstanceData *attractorInstance) const {
+    attractorInstance->model = glm::mat4(1.0f);
+    transform(&attractorInstance->model);
+
+    // attractors never change colour
+    attractorInstance->fromColour = glm::vec3(colour.getX(), colour.getY(), colour.getZ());
+    attractorInstance->toColour   = attractorInstance->fromColour;
+    attractorInstance->changeTime = 0.0f;
 }
@@ -0,0 +1,223 @@
+/**
+ * Audio output stream on a chosen backend, or a null device keeping time without hardware
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <stk/Stk.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <AudioDevice.h>
+
+AudioDevice::~AudioDevice() {
+    close();
+}
+
+/**
+ * Open a stream, the buffer size and period count may be changed by the backend
+ *
+ * @param const AudioConfig &config
+ * @param RtAudioCallback streamCallback
+ * @param void *streamData
+ * @return bool
+ */
+bool AudioDevice::open(const AudioConfig &config, RtAudioCallback streamCallback, void *streamData) {
+    close();
+
+    callback     = streamCallback;
+    userData     = streamData;
+    backend      = config.backend;
+    bufferFrames = config.bufferFrames;
+    periods      = config.periods;
+    sampleRate   = config.sampleRate;
+    channels     = config.channels;
+
+    if (backend == AUDIO_BACKEND_NULL) {
+        return true;
+    }
+
+    RtAudio::Api api = backend == AUDIO_BACKEND_ALSA ? RtAudio::LINUX_ALSA : backend == AUDIO_BACKEND_JACK ? RtAudio::UNIX_JACK : RtAudio::UNSPECIFIED;
+
+    RtAudio::StreamParameters parameters;
+    RtAudio::StreamOptions    options;
+
+    options.flags           = RTAUDIO_SCHEDULE_REALTIME | RTAUDIO_MINIMIZE_LATENCY;
+    options.numberOfBuffers = periods;
+    options.streamName      = "Swarm Music";
+
+    RtAudioFormat format = (sizeof(stk::StkFloat) == 8) ? RTAUDIO_FLOAT64 : RTAUDIO_FLOAT32;
+
+    try {
+        dac.reset(new RtAudio(api));
+
+        if (dac->getDeviceCount() == 0) {
+            std::cerr << "ERROR::AUDIO_DEVICE::NO_DEVICES " << getBackendName(backend) << std::endl;
+            dac.reset();
+            return false;
+        }
+
+        parameters.deviceId  = dac->getDefaultOutputDevice();
+        parameters.nChannels = channels;
+
+        dac->openStream(&parameters, NULL, format, sampleRate, &bufferFrames, callback, userData, &options);
+    } catch (RtAudioError &error) {
+        error.printMessage();
+        dac.reset();
+        return false;
+    }
+
+    periods = options.numberOfBuffers;
+
+    return true;
+}
+
+/**
+ * @return bool
+ */
+bool AudioDevice::start() {
+    if (backend == AUDIO_BACKEND_NULL) {
+        running.store(true);
+        worker = std::thread(&AudioDevice::runNull, this);
+        return true;
+    }
+
+    if (!dac) {
+        return false;
+    }
+
+    try {
+        dac->startStream();
+    } catch (RtAudioError &error) {
+        error.printMessage();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Stop and close the stream, if open
+ *
+ * @return void
+ */
+void AudioDevice::close() {
+    if (worker.joinable()) {
+        running.store(false);
+        worker.join();
+    }
+
+    if (dac) {
+        try {
+            if (dac->isStreamOpen()) {
+                dac->closeStream();
+            }
+        } catch (RtAudioError &error) {
+            error.printMessage();
+        }
+        dac.reset();
+    }
+
+    callback = NULL;
+}
+
+/**
+ * Call back with buffers that go nowhere, on the deadlines a device would set
+ *
+ * @return void
+ */
+void AudioDevice::runNull() {
+    std::vector<stk::StkFloat> buffer(bufferFrames * channels);
+
+    std::chrono::duration<double>         period(bufferFrames / (double) sampleRate);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+
+    double streamTime = 0.0;
+
+    while (running.load()) {
+        callback(buffer.data(), NULL, bufferFrames, streamTime, 0, userData);
+
+        streamTime += period.count();
+        deadline   += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+bool AudioDevice::isOpen() const {
+    return backend == AUDIO_BACKEND_NULL ? callback != NULL : (bool) dac;
+}
+
+unsigned int AudioDevice::getBufferFrames() const {
+    return this->bufferFrames;
+}
+
+unsigned int AudioDevice::getPeriods() const {
+    return this->periods;
+}
+
+unsigned int AudioDevice::getSampleRate() const {
+    return this->sampleRate;
+}
+
+unsigned int AudioDevice::getChannels() const {
+    return this->channels;
+}
+
+/**
+ * Output latency reported by the backend, in seconds
+ *
+ * @return double
+ */
+double AudioDevice::getLatency() const {
+    long latency = dac ? dac->getStreamLatency() : 0;
+
+    // not every backend knows, assume the device holds every period
+    if (latency <= 0) {
+        latency = bufferFrames * std::max(periods, 1u);
+    }
+
+    return latency / (double) sampleRate;
+}
+
+/**
+ * @param int backend
+ * @return const char*
+ */
+const char *AudioDevice::getBackendName(int backend) {
+    switch (backend) {
+        case AUDIO_BACKEND_ALSA:
+            return "ALSA";
+        case AUDIO_BACKEND_JACK:
+            return "JACK";
+        case AUDIO_BACKEND_NULL:
+            return "null";
+        default:
+            return "default";
+    }
+}
+
+/**
+ * Backend from its name on the command line
+ *
+ * @param const std::string &name alsa, jack, null or default
+ * @return int Backend, -1 if unknown
+ */
+int AudioDevice::parseBackend(const std::string &name) {
+    for (int backend = AUDIO_BACKEND_DEFAULT; backend <= AUDIO_BACKEND_NULL; ++backend) {
+        std::string candidate = getBackendName(backend);
+        for (char &c : candidate) {
+            c = tolower(c);
+        }
+
+        if (candidate == name) {
+            return backend;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,163 @@
+/**
+ * Timing of the audio callback against its deadline
+ *
+ * The callback's run time is compared with the time its buffer takes to play, its load.
+ * Loads are binned in relaxed atomics the callback only ever increments, so recording never
+ * blocks and the UI reads a consistent enough picture at any time
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+#include <iomanip>
+
+#include <AudioMonitor.h>
+
+AudioMonitor::AudioMonitor() {
+    reset();
+}
+
+/**
+ * Forget every callback, only while no stream is running
+ *
+ * @return void
+ */
+void AudioMonitor::reset() {
+    for (int bin = 0; bin < AUDIO_LOAD_BINS; ++bin) {
+        histogram[bin].store(0, std::memory_order_relaxed);
+    }
+
+    callbacks.store(0, std::memory_order_relaxed);
+    underflows.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    worstLoad.store(0.0f, std::memory_order_relaxed);
+    lastLoad.store(0.0f, std::memory_order_relaxed);
+}
+
+/**
+ * Record one callback, from the end of the callback
+ *
+ * @param std::chrono::steady_clock::time_point started When the callback was entered
+ * @param unsigned int frames Frames in the buffer
+ * @param double sampleRate
+ * @param bool underflow Whether the device reported an output underflow before this buffer
+ * @return void
+ */
+void AudioMonitor::record(std::chrono::steady_clock::time_point started, unsigned int frames, double sampleRate, bool underflow) {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    float  load    = elapsed * sampleRate / frames;
+
+    int bin = std::min((int) (load / AUDIO_LOAD_WIDTH), AUDIO_LOAD_BINS - 1);
+
+    histogram[bin].fetch_add(1, std::memory_order_relaxed);
+    callbacks.fetch_add(1, std::memory_order_relaxed);
+
+    if (underflow) {
+        underflows.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (load > 1.0f) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // single writer, no need for a compare and swap
+    if (load > worstLoad.load(std::memory_order_relaxed)) {
+        worstLoad.store(load, std::memory_order_relaxed);
+    }
+    lastLoad.store(load, std::memory_order_relaxed);
+}
+
+unsigned int AudioMonitor::getCallbacks() const {
+    return this->callbacks.load(std::memory_order_relaxed);
+}
+
+unsigned int AudioMonitor::getUnderflows() const {
+    return this->underflows.load(std::memory_order_relaxed);
+}
+
+unsigned int AudioMonitor::getOverruns() const {
+    return this->overruns.load(std::memory_order_relaxed);
+}
+
+float AudioMonitor::getWorstLoad() const {
+    return this->worstLoad.load(std::memory_order_relaxed);
+}
+
+float AudioMonitor::getLastLoad() const {
+    return this->lastLoad.load(std::memory_order_relaxed);
+}
+
+/**
+ * Callbacks with a load in one histogram bin
+ *
+ * @param int bin
+ * @return unsigned int
+ */
+unsigned int AudioMonitor::getBin(int bin) const {
+    return this->histogram[bin].load(std::memory_order_relaxed);
+}
+
+/**
+ * Load under which a share of the callbacks ran, to the upper edge of its bin
+ *
+ * @param float percentile 0 to 1
+ * @return float
+ */
+float AudioMonitor::getPercentile(float percentile) const {
+    unsigned int counts[AUDIO_LOAD_BINS];
+    unsigned int total = 0;
+
+    for (int bin = 0; bin < AUDIO_LOAD_BINS; ++bin) {
+        counts[bin] = getBin(bin);
+        total      += counts[bin];
+    }
+
+    if (total == 0) {
+        return 0.0f;
+    }
+
+    unsigned int wanted = percentile * total;
+    unsigned int seen   = 0;
+
+    for (int bin = 0; bin < AUDIO_LOAD_BINS - 1; ++bin) {
+        seen += counts[bin];
+        if (seen > wanted) {
+            return std::min((bin + 1) * AUDIO_LOAD_WIDTH, getWorstLoad());
+        }
+    }
+
+    return getWorstLoad();
+}
+
+/**
+ * Print a summary, to size the buffer for the machine
+ *
+ * @param std::ostream &stream
+ * @return void
+ */
+void AudioMonitor::report(std::ostream &stream) const {
+    unsigned int total = getCallbacks();
+
+    stream << "Audio callbacks: " << total << std::endl;
+    if (total == 0) {
+        return;
+    }
+
+    stream << std::fixed << std::setprecision(1)
+           << "  Underflows " << getUnderflows() << ", overruns " << getOverruns()
+           << ", p99 load " << getPercentile(0.99f) * 100.0f << "%"
+           << ", worst " << getWorstLoad() * 100.0f << "%" << std::endl;
+
+    for (int bin = 0; bin < AUDIO_LOAD_BINS; ++bin) {
+        unsigned int count = getBin(bin);
+        if (count == 0) {
+            continue;
+        }
+
+        stream << "  " << std::setw(4) << (int) (bin * AUDIO_LOAD_WIDTH * 100.0f) << "%"
+               << (bin == AUDIO_LOAD_BINS - 1 ? "+ " : "  ")
+               << std::setw(8) << count
+               << std::setw(7) << 100.0f * count / total << "%" << std::endl;
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * Musical time on the audio clock, converting between sample frames and bars, beats and ticks
+ *
+ * Frames are the only time base, so everything scheduled against the clock is placed to the
+ * sample whenever the thread computing it happens to run. Tempo changes take effect from a
+ * given frame and leave the ticks before it where they were
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <BeatClock.h>
+
+/**
+ * @param double sampleRate
+ * @param float tempo Beats per minute
+ * @param int beatsPerBar
+ */
+BeatClock::BeatClock(double sampleRate, float tempo, int beatsPerBar) : sampleRate(sampleRate), tempo(tempo), beatsPerBar(std::max(beatsPerBar, 1)), originFrame(0), originTick(0.0) {
+    framesPerTick = sampleRate * 60.0 / (tempo * BEAT_TICKS);
+}
+
+float BeatClock::getTempo() const {
+    return this->tempo;
+}
+
+/**
+ * Change tempo from a frame on, usually a bar line
+ *
+ * @param float bpm
+ * @param unsigned long long frame
+ * @return void
+ */
+void BeatClock::setTempo(float bpm, unsigned long long frame) {
+    originTick    = getTick(frame);
+    originFrame   = frame;
+    tempo         = bpm;
+    framesPerTick = sampleRate * 60.0 / (tempo * BEAT_TICKS);
+}
+
+int BeatClock::getBeatsPerBar() const {
+    return this->beatsPerBar;
+}
+
+void BeatClock::setBeatsPerBar(int beats) {
+    this->beatsPerBar = std::max(beats, 1);
+}
+
+/**
+ * @param unsigned long long frame
+ * @return double Ticks since the clock started, at the current tempo throughout
+ */
+double BeatClock::getTick(unsigned long long frame) const {
+    return originTick + (double) (long long) (frame - originFrame) / framesPerTick;
+}
+
+/**
+ * @param double tick
+ * @return unsigned long long Frame the tick falls on, at the current tempo throughout
+ */
+unsigned long long BeatClock::getFrame(double tick) const {
+    return originFrame + (unsigned long long) std::llround((tick - originTick) * framesPerTick);
+}
+
+/**
+ * Move a frame onto the grid, never earlier
+ *
+ * @param unsigned long long frame
+ * @param int grid Ticks between grid lines
+ * @return unsigned long long First grid line at or after frame
+ */
+unsigned long long BeatClock::quantise(unsigned long long frame, int grid) const {
+    double tick = getTick(frame);
+
+    // a frame rounded down from a grid line is still on it
+    double line = std::ceil(tick / grid - 1e-6) * grid;
+
+    return std::max(getFrame(line), frame);
+}
+
+/**
+ * @param unsigned long long frame
+ * @return unsigned long long First bar line after frame
+ */
+unsigned long long BeatClock::nextBar(unsigned long long frame) const {
+    double bar = (double) beatsPerBar * BEAT_TICKS;
+
+    return getFrame((std::floor(getTick(frame) / bar + 1e-6) + 1.0) * bar);
+}
+
+/**
+ * @param unsigned long long frame
+ * @return float How far through its bar the frame is, from 0 to 1
+ */
+float BeatClock::getBarPosition(unsigned long long frame) const {
+    double bar      = (double) beatsPerBar * BEAT_TICKS;
+    double position = getTick(frame) / bar;
+
+    return std::min(std::max((float) (position - std::floor(position + 1e-6)), 0.0f), 1.0f);
+}
+
+/**
+ * @return double Length of a bar at the current tempo
+ */
+double BeatClock::getBarSeconds() const {
+    return beatsPerBar * 60.0 / tempo;
+}
@@ -0,0 +1,239 @@
+/**
+ * Groups of agents within reach of each other, found every simulation step
+ *
+ * Agents closer than the radius are joined with a union-find. Candidate pairs come from a
+ * uniform grid with cells at least the radius wide, so each agent is only compared with the
+ * agents in its own cell and half of the 26 around it, which keeps a step linear in the
+ * number of agents. Large swarms are split across threads by slabs of the grid
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <thread>
+
+#include <Clusters.h>
+#include <Trace.h>
+
+// neighbouring cells visited from each cell, every other neighbour visits this one instead
+const int HALF_STENCIL[13][3] = {
+    { 1,  0,  0},
+    {-1,  1,  0}, { 0,  1,  0}, { 1,  1,  0},
+    {-1, -1,  1}, { 0, -1,  1}, { 1, -1,  1},
+    {-1,  0,  1}, { 0,  0,  1}, { 1,  0,  1},
+    {-1,  1,  1}, { 0,  1,  1}, { 1,  1,  1}
+};
+
+/**
+ * Clusters from the last update, largest first
+ *
+ * @return const std::vector<Cluster>&
+ */
+const std::vector<Cluster> &Clusters::get() const {
+    return this->clusters;
+}
+
+/**
+ * Root of an agent's set, halving the path on the way
+ *
+ * @param int agent
+ * @return int
+ */
+int Clusters::find(int agent) {
+    while (parent[agent] != agent) {
+        parent[agent] = parent[parent[agent]];
+        agent         = parent[agent];
+    }
+
+    return agent;
+}
+
+/**
+ * Join two agents' sets, the smaller under the larger
+ *
+ * @param int a
+ * @param int b
+ * @return void
+ */
+void Clusters::unite(int a, int b) {
+    // most pairs in a flock are already joined, check before the full finds
+    if (parent[a] == parent[b]) {
+        return;
+    }
+
+    a = find(a);
+    b = find(b);
+
+    if (a == b) {
+        return;
+    }
+
+    if (count[a] < count[b]) {
+        std::swap(a, b);
+    }
+
+    parent[b] = a;
+    count[a] += count[b];
+}
+
+/**
+ * Join the agents closer than the radius in a range of z slabs
+ *
+ * @param int zBegin
+ * @param int zEnd
+ * @param bool border Only join with the slab after zEnd, otherwise only within the range
+ * @return void
+ */
+void Clusters::joinSlabs(int zBegin, int zEnd, bool border) {
+    for (int z = zBegin; z < zEnd; ++z) {
+        for (int y = 0; y < dimension; ++y) {
+            for (int x = 0; x < dimension; ++x) {
+                int cell  = (z * dimension + y) * dimension + x;
+                int begin = cellStart[cell], end = cellStart[cell + 1];
+
+                // pairs inside the cell
+                for (int i = begin; i < end && !border; ++i) {
+                    for (int j = i + 1; j < end; ++j) {
+                        glm::vec3 offset = sorted[i] - sorted[j];
+                        if (glm::dot(offset, offset) < radius2) {
+                            unite(i, j);
+                        }
+                    }
+                }
+
+                // pairs with the forward half of the neighbours
+                for (const int *step : HALF_STENCIL) {
+                    int nx = x + step[0], ny = y + step[1], nz = z + step[2];
+                    if (nx < 0 || ny < 0 || nx >= dimension || ny >= dimension || nz >= dimension) {
+                        continue;
+                    }
+                    if ((nz >= zEnd) != border) {
+                        continue;
+                    }
+
+                    int neighbour = (nz * dimension + ny) * dimension + nx;
+                    for (int i = begin; i < end; ++i) {
+                        for (int j = cellStart[neighbour]; j < cellStart[neighbour + 1]; ++j) {
+                            glm::vec3 offset = sorted[i] - sorted[j];
+                            if (glm::dot(offset, offset) < radius2) {
+                                unite(i, j);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Find the clusters of agents connected through neighbours closer than radius
+ *
+ * @param const std::vector<Agent> &agents
+ * @param float radius
+ * @param float speed Agent speed, to turn the mean direction into a velocity
+ * @return void
+ */
+void Clusters::update(const std::vector<Agent> &agents, float radius, float speed) {
+    TRACE_SCOPE("Clusters::update");
+
+    int size = agents.size();
+
+    clusters.clear();
+    if (size == 0 || radius <= 0.0f) {
+        return;
+    }
+
+    float cellSize  = std::max(radius, (CUBE_HALF_SIZE * 2) / CLUSTER_GRID_MAX);
+    int   cellCount;
+
+    dimension = std::min((int) ceil((CUBE_HALF_SIZE * 2) / cellSize), CLUSTER_GRID_MAX);
+    cellCount = dimension * dimension * dimension;
+    radius2   = radius * radius;
+
+    positions.resize(size);
+    cellOf.resize(size);
+    order.resize(size);
+    cellStart.assign(cellCount + 1, 0);
+
+    // bucket agents by cell, agents pushed outside the cube go to the border cells
+    for (int i = 0; i < size; ++i) {
+        Triplet position = agents[i].getPosition();
+        positions[i] = glm::vec3(position.getX(), position.getY(), position.getZ());
+
+        int cell[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            cell[axis] = std::min(std::max((int) ((positions[i][axis] + CUBE_HALF_SIZE) / cellSize), 0), dimension - 1);
+        }
+
+        cellOf[i] = (cell[2] * dimension + cell[1]) * dimension + cell[0];
+        ++cellStart[cellOf[i] + 1];
+    }
+
+    std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+
+    // agents are joined by their slot in cell order, so neighbours sit next to each other in memory
+    label.assign(cellStart.begin(), cellStart.end() - 1); // next free slot per cell
+    sorted.resize(size);
+    for (int i = 0; i < size; ++i) {
+        int slot = label[cellOf[i]]++;
+        order[slot]  = i;
+        sorted[slot] = positions[i];
+    }
+
+    parent.resize(size);
+    count.assign(size, 1);
+    std::iota(parent.begin(), parent.end(), 0);
+
+    // slabs of cells along z are contiguous runs of slots, so threads given separate slabs join
+    // disjoint parts of the union-find; pairs across their borders are joined afterwards
+    int threads = size < CLUSTER_PARALLEL_MIN ? 1 : std::min((int) std::thread::hardware_concurrency(), dimension);
+    threads = std::max(threads, 1);
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(&Clusters::joinSlabs, this, t * dimension / threads, (t + 1) * dimension / threads, false);
+    }
+    joinSlabs(0, dimension / threads, false);
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    for (int t = 1; t < threads; ++t) {
+        int border = t * dimension / threads - 1;
+        joinSlabs(border, border + 1, true);
+    }
+
+    // one cluster per large enough set
+    label.assign(size, -1);
+    for (int slot = 0; slot < size; ++slot) {
+        int i    = order[slot];
+        int root = find(slot);
+        if (count[root] < CLUSTER_MIN_SIZE) {
+            continue;
+        }
+
+        if (label[root] < 0) {
+            label[root] = clusters.size();
+            clusters.push_back(Cluster {Triplet(0.0f, 0.0f, 0.0f), Triplet(0.0f, 0.0f, 0.0f), 0});
+        }
+
+        Cluster &cluster = clusters[label[root]];
+        cluster.centroid = cluster.centroid + agents[i].getPosition();
+        cluster.velocity = cluster.velocity + agents[i].getDirection();
+        ++cluster.size;
+    }
+
+    for (Cluster &cluster : clusters) {
+        cluster.centroid.scalarDiv(cluster.size);
+        cluster.velocity.scalarMul(speed / cluster.size);
+    }
+
+    std::sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+        return a.size > b.size;
+    });
+}
@@ -0,0 +1,307 @@
+/**
+ * Live frame capture through a ring of pixel buffer objects and a writer thread
+ *
+ * Each frame is read into a pixel buffer object without waiting for the GPU, and only mapped
+ * CAPTURE_BUFFERS - 1 frames later, once the transfer has finished. Conversion and disk writes
+ * happen on the writer thread
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <FrameCapture.h>
+#include <Trace.h>
+
+FrameCapture::FrameCapture() {
+    for (int i = 0; i < CAPTURE_BUFFERS; ++i) {
+        buffers[i] = 0;
+        pending[i] = false;
+    }
+}
+
+FrameCapture::~FrameCapture() {
+    stop();
+}
+
+/**
+ * Start recording the default framebuffer to a file
+ *
+ * Needs a current GL context
+ *
+ * @param const std::string &path
+ * @param int width Framebuffer width, kept for the whole recording
+ * @param int height
+ * @param int format CAPTURE_Y4M or CAPTURE_RAW (RGBA, rows top to bottom)
+ * @param int frameRate Written to the Y4M header
+ * @return bool
+ */
+bool FrameCapture::start(const std::string &path, int width, int height, int format, int frameRate) {
+    if (recording) {
+        stop();
+    }
+
+    // Y4M 4:2:0 chroma needs even dimensions
+    if (format == CAPTURE_Y4M) {
+        width  &= ~1;
+        height &= ~1;
+    }
+
+    file.open(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR::CAPTURE::FILE_NOT_OPENED " << path << std::endl;
+        return false;
+    }
+
+    if (format == CAPTURE_Y4M) {
+        file << "YUV4MPEG2 W" << width << " H" << height << " F" << frameRate << ":1 Ip A1:1 C420jpeg\n";
+    }
+
+    this->width  = width;
+    this->height = height;
+    this->format = format;
+
+    glGenBuffers(CAPTURE_BUFFERS, buffers);
+    for (int i = 0; i < CAPTURE_BUFFERS; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, NULL, GL_STREAM_READ);
+        pending[i] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    frames.assign(CAPTURE_FRAMES, std::vector<unsigned char>(width * height * 4));
+    freeFrames.clear();
+    queuedFrames.clear();
+    for (int i = 0; i < CAPTURE_FRAMES; ++i) {
+        freeFrames.push_back(i);
+    }
+
+    bufferIndex = 0;
+    captured    = 0;
+    dropped     = 0;
+    stopping    = false;
+    recording   = true;
+
+    writer = std::thread(&FrameCapture::write, this);
+
+    return true;
+}
+
+/**
+ * Collect the frames still in flight, let the writer drain its queue and close the file
+ *
+ * @return void
+ */
+void FrameCapture::stop() {
+    if (!recording) {
+        return;
+    }
+
+    for (int i = 1; i <= CAPTURE_BUFFERS; ++i) {
+        collect((bufferIndex + i) % CAPTURE_BUFFERS);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_one();
+
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    glDeleteBuffers(CAPTURE_BUFFERS, buffers);
+    file.close();
+
+    recording = false;
+
+    std::cout << "Captured " << captured << " frames, dropped " << dropped << std::endl;
+}
+
+/**
+ * Queue a readback of the current frame and hand the oldest finished one to the writer
+ *
+ * Call after drawing and before swapping buffers
+ *
+ * @return void
+ */
+void FrameCapture::capture() {
+    if (!recording) {
+        return;
+    }
+
+    TRACE_SCOPE("FrameCapture::capture");
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[bufferIndex]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pending[bufferIndex] = true;
+
+    bufferIndex = (bufferIndex + 1) % CAPTURE_BUFFERS;
+
+    // the next buffer in the ring was read CAPTURE_BUFFERS - 1 frames ago
+    collect(bufferIndex);
+}
+
+/**
+ * Map a finished readback and copy it into a free frame for the writer, or drop it if the
+ * writer has fallen behind
+ *
+ * @param int index
+ * @return void
+ */
+void FrameCapture::collect(int index) {
+    if (!pending[index]) {
+        return;
+    }
+    pending[index] = false;
+
+    int frame = -1;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!freeFrames.empty()) {
+            frame = freeFrames.back();
+            freeFrames.pop_back();
+        }
+    }
+
+    if (frame < 0) {
+        ++dropped;
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[index]);
+    void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 4, GL_MAP_READ_BIT);
+    if (pixels != NULL) {
+        memcpy(frames[frame].data(), pixels, frames[frame].size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (pixels != NULL) {
+            queuedFrames.push_back(frame);
+            ++captured;
+        } else {
+            freeFrames.push_back(frame);
+            ++dropped;
+        }
+    }
+    queueCondition.notify_one();
+}
+
+/**
+ * Writer thread, converts and writes queued frames until stopped and drained
+ *
+ * @return void
+ */
+void FrameCapture::write() {
+    TRACE_THREAD("Capture");
+
+    std::vector<unsigned char> planes(width * height * 3 / 2);
+
+    while (true) {
+        int frame;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this] { return stopping || !queuedFrames.empty(); });
+
+            if (queuedFrames.empty()) {
+                return;
+            }
+
+            frame = queuedFrames.front();
+            queuedFrames.pop_front();
+        }
+
+        {
+            TRACE_SCOPE("FrameCapture::write");
+
+            if (format == CAPTURE_Y4M) {
+                writeY4M(frames[frame].data(), planes);
+            } else {
+                writeRaw(frames[frame].data());
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        freeFrames.push_back(frame);
+    }
+}
+
+/**
+ * Convert to full range BT.601 4:2:0 planes and write one Y4M frame
+ *
+ * @param const unsigned char *pixels RGBA, rows bottom to top
+ * @param std::vector<unsigned char> &planes
+ * @return void
+ */
+void FrameCapture::writeY4M(const unsigned char *pixels, std::vector<unsigned char> &planes) {
+    unsigned char *luma = planes.data();
+    unsigned char *cb   = luma + width * height;
+    unsigned char *cr   = cb + (width / 2) * (height / 2);
+
+    for (int y = 0; y < height; ++y) {
+        const unsigned char *row = pixels + (height - 1 - y) * width * 4;
+
+        for (int x = 0; x < width; ++x) {
+            const unsigned char *pixel = row + x * 4;
+            luma[y * width + x] = (unsigned char) std::min(255.0f, 0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2]);
+        }
+    }
+
+    for (int y = 0; y < height / 2; ++y) {
+        const unsigned char *top    = pixels + (height - 1 - y * 2) * width * 4;
+        const unsigned char *bottom = top - width * 4;
+
+        for (int x = 0; x < width / 2; ++x) {
+            float r = (top[x * 8]     + top[x * 8 + 4] + bottom[x * 8]     + bottom[x * 8 + 4]) / 4.0f;
+            float g = (top[x * 8 + 1] + top[x * 8 + 5] + bottom[x * 8 + 1] + bottom[x * 8 + 5]) / 4.0f;
+            float b = (top[x * 8 + 2] + top[x * 8 + 6] + bottom[x * 8 + 2] + bottom[x * 8 + 6]) / 4.0f;
+
+            cb[y * (width / 2) + x] = (unsigned char) std::max(0.0f, std::min(255.0f, 128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b));
+            cr[y * (width / 2) + x] = (unsigned char) std::max(0.0f, std::min(255.0f, 128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b));
+        }
+    }
+
+    file << "FRAME\n";
+    file.write((const char *) planes.data(), planes.size());
+}
+
+/**
+ * @param const unsigned char *pixels RGBA, rows bottom to top
+ * @return void
+ */
+void FrameCapture::writeRaw(const unsigned char *pixels) {
+    for (int y = height - 1; y >= 0; --y) {
+        file.write((const char *) pixels + y * width * 4, width * 4);
+    }
+}
+
+bool FrameCapture::isRecording() const {
+    return this->recording;
+}
+
+int FrameCapture::getWidth() const {
+    return this->width;
+}
+
+int FrameCapture::getHeight() const {
+    return this->height;
+}
+
+int FrameCapture::getCaptured() const {
+    return this->captured;
+}
+
+int FrameCapture::getDropped() const {
+    return this->dropped;
+}
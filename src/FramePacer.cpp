@@ -0,0 +1,158 @@
+/**
+ * Frame pacing for the render loop, with frame time jitter statistics
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <GLFW/glfw3.h>
+
+#include <cmath>
+#include <thread>
+
+#include <FramePacer.h>
+#include <Trace.h>
+
+/**
+ * @param double targetInterval Seconds per frame, usually the monitor refresh interval
+ * @param int mode One of the PACING_ constants
+ */
+FramePacer::FramePacer(double targetInterval, int mode) : targetInterval(targetInterval), spinTail(0.002) {
+    lastFrame = Clock::now();
+    deadline  = lastFrame;
+
+    setMode(mode);
+}
+
+int FramePacer::getMode() const {
+    return this->mode;
+}
+
+/**
+ * Change pacing mode, only vsync lets the driver block in glfwSwapBuffers
+ *
+ * Needs the window's context to be current
+ *
+ * @param int value
+ * @return void
+ */
+void FramePacer::setMode(int value) {
+    mode = value;
+    glfwSwapInterval(mode == PACING_VSYNC ? 1 : 0);
+
+    deadline = Clock::now();
+}
+
+float FramePacer::getSpinTail() const {
+    return this->spinTail * 1000.0;
+}
+
+/**
+ * @param float value Milliseconds spent spinning before the deadline instead of sleeping
+ * @return void
+ */
+void FramePacer::setSpinTail(float value) {
+    spinTail = value / 1000.0;
+}
+
+double FramePacer::getTargetInterval() const {
+    return this->targetInterval;
+}
+
+/**
+ * Wait for the start of the next frame
+ *
+ * In hybrid mode the thread sleeps until shortly before the deadline and only spins for
+ * the last spinTail seconds, which the OS scheduler cannot be trusted with
+ *
+ * @return void
+ */
+void FramePacer::wait() {
+    TRACE_SCOPE("FramePacer::wait");
+
+    if (mode == PACING_HYBRID) {
+        Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(targetInterval));
+        Clock::duration tail     = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spinTail));
+
+        deadline += interval;
+
+        // fell more than a frame behind, don't try to catch up
+        Clock::time_point now = Clock::now();
+        if (now > deadline + interval) {
+            deadline = now;
+        }
+
+        if (deadline - tail > now) {
+            std::this_thread::sleep_until(deadline - tail);
+        }
+
+        while (Clock::now() < deadline) {
+            // spin for the tail
+        }
+    }
+
+    record(Clock::now());
+}
+
+void FramePacer::record(Clock::time_point now) {
+    intervals[intervalIndex] = std::chrono::duration<float>(now - lastFrame).count();
+    intervalIndex = (intervalIndex + 1) % FRAME_HISTORY;
+    if (intervalCount < FRAME_HISTORY) {
+        ++intervalCount;
+    }
+
+    lastFrame = now;
+}
+
+/**
+ * Mean frame interval over the recorded history in seconds
+ *
+ * @return float
+ */
+float FramePacer::getMeanInterval() const {
+    if (intervalCount == 0) {
+        return 0.0f;
+    }
+
+    float sum = 0.0f;
+    for (int i = 0; i < intervalCount; ++i) {
+        sum += intervals[i];
+    }
+
+    return sum / intervalCount;
+}
+
+/**
+ * Frame time jitter, the standard deviation of the frame interval in seconds
+ *
+ * @return float
+ */
+float FramePacer::getJitter() const {
+    if (intervalCount < 2) {
+        return 0.0f;
+    }
+
+    float mean = getMeanInterval();
+    float sum  = 0.0f;
+    for (int i = 0; i < intervalCount; ++i) {
+        sum += (intervals[i] - mean) * (intervals[i] - mean);
+    }
+
+    return sqrt(sum / (intervalCount - 1));
+}
+
+/**
+ * Longest frame interval over the recorded history in seconds
+ *
+ * @return float
+ */
+float FramePacer::getWorstInterval() const {
+    float worst = 0.0f;
+    for (int i = 0; i < intervalCount; ++i) {
+        if (intervals[i] > worst) {
+            worst = intervals[i];
+        }
+    }
+
+    return worst;
+}
@@ -0,0 +1,223 @@
+/**
+ * GPU geometry for the scene primitives, built once and shared by every draw
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include <Agent.h>
+#include <Attractor.h>
+#include <Mesh.h>
+
+/**
+ * Upload geometry and describe its layout
+ *
+ * Vertices are positions, or interleaved positions and normals when hasNormals is set
+ *
+ * @param const std::vector<float> &vertices
+ * @param const std::vector<unsigned int> &indices
+ * @param unsigned int mode Primitive type, e.g. GL_TRIANGLES
+ * @param bool hasNormals
+ * @param bool instanced Whether to attach a per-instance buffer
+ */
+Mesh::Mesh(
+    const std::vector<float> &vertices,
+    const std::vector<unsigned int> &indices,
+    unsigned int mode,
+    bool hasNormals,
+    bool instanced
+) : instanceVBO(0), mode(mode), indexCount(indices.size()) {
+    int stride = (hasNormals ? 6 : 3) * sizeof(float);
+
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenVertexArrays(1, &VAO);
+
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*) 0);
+    glEnableVertexAttribArray(0);
+
+    if (hasNormals) {
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*) (3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+
+    if (instanced) {
+        setupInstanceAttributes();
+    }
+
+    glBindVertexArray(0);
+}
+
+Mesh::~Mesh() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &VBO);
+
+    if (instanceVBO != 0) {
+        glDeleteBuffers(1, &instanceVBO);
+    }
+}
+
+/**
+ * Per-instance model matrix (one attribute per column) and colour transition
+ *
+ * @return void
+ */
+void Mesh::setupInstanceAttributes() {
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+    for (int i = 0; i < 4; ++i) {
+        glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*) (offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(2 + i);
+        glVertexAttribDivisor(2 + i, 1);
+    }
+
+    glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*) offsetof(InstanceData, fromColour));
+    glEnableVertexAttribArray(6);
+    glVertexAttribDivisor(6, 1);
+
+    glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*) offsetof(InstanceData, toColour));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+
+    glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*) offsetof(InstanceData, changeTime));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+}
+
+int Mesh::getIndexCount() const {
+    return this->indexCount;
+}
+
+void Mesh::bind() const {
+    glBindVertexArray(VAO);
+}
+
+/**
+ * Draw a single copy of the mesh with the current program
+ *
+ * @return void
+ */
+void Mesh::draw() const {
+    glBindVertexArray(VAO);
+    glDrawElements(mode, indexCount, GL_UNSIGNED_INT, 0);
+}
+
+/**
+ * Upload instance data and draw one copy per instance
+ *
+ * @param const InstanceData *instances
+ * @param int count
+ * @return void
+ */
+void Mesh::drawInstanced(const InstanceData *instances, int count) const {
+    if (instanceVBO == 0 || count == 0) {
+        return;
+    }
+
+    glBindVertexArray(VAO);
+
+    // orphan last frame's storage so the upload does not wait on the GPU
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+
+    glDrawElementsInstanced(mode, indexCount, GL_UNSIGNED_INT, 0, count);
+}
+
+/**
+ * Get a primitive, building it on first use
+ *
+ * @param int primitive One of the MESH_ constants
+ * @return const Mesh &
+ */
+const Mesh &MeshCache::get(int primitive) {
+    if (!meshes[primitive]) {
+        meshes[primitive].reset(build(primitive));
+    }
+
+    return *meshes[primitive];
+}
+
+/**
+ * Release all GL objects, must be called while the context is current
+ *
+ * @return void
+ */
+void MeshCache::clear() {
+    for (int i = 0; i < MESH_COUNT; ++i) {
+        meshes[i].reset();
+    }
+}
+
+Mesh *MeshCache::build(int primitive) {
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    switch (primitive) {
+        case MESH_CONE:
+            Agent::geometry(vertices, indices);
+            return new Mesh(vertices, indices, GL_TRIANGLES, true, true);
+        case MESH_SPHERE:
+            Attractor::geometry(vertices, indices);
+            return new Mesh(vertices, indices, GL_TRIANGLES, true, true);
+        case MESH_POINT:
+            // a single vertex per instance, expanded into a sprite by the impostor shader
+            vertices = {0.0f, 0.0f, 0.0f};
+            indices  = {0};
+            return new Mesh(vertices, indices, GL_POINTS, false, true);
+        default:
+            wireCubeGeometry(vertices, indices);
+            return new Mesh(vertices, indices, GL_LINES, false, false);
+    }
+}
+
+/**
+ * Unit cube edges, scaled up for the swarm bounds and down for the light source
+ *
+ * @param std::vector<float> &vertices
+ * @param std::vector<unsigned int> &indices
+ * @return void
+ */
+void MeshCache::wireCubeGeometry(std::vector<float> &vertices, std::vector<unsigned int> &indices) {
+    vertices = {
+        -1.0f,  1.0f, -1.0f,
+        -1.0f,  1.0f,  1.0f,
+         1.0f,  1.0f, -1.0f,
+         1.0f,  1.0f,  1.0f,
+        -1.0f, -1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f,
+         1.0f, -1.0f, -1.0f,
+         1.0f, -1.0f,  1.0f,
+    };
+
+    indices = {
+        0, 1,
+        1, 3,
+        3, 2,
+        2, 0,
+        0, 4,
+        1, 5,
+        2, 6,
+        3, 7,
+        4, 5,
+        5, 7,
+        7, 6,
+        6, 4,
+    };
+}
@@ -0,0 +1,240 @@
+/**
+ * Note events sent as MIDI, to a sequencer port or a Standard MIDI File
+ *
+ * Each bank plays on its own channel with a General MIDI program close to its STK instrument,
+ * so any synth can stand in for the voice pool. MIDI has no glide for a single note, a held
+ * note changing pitch is restarted on the new key and one changing velocity gets polyphonic
+ * aftertouch. Files are one track at a fixed tempo, with event times kept in real time
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include <MidiOutput.h>
+
+/**
+ * Open the port and check the file can be written
+ *
+ * @param const MidiConfig &config
+ * @param double rate Sample rate event times count in
+ * @return bool
+ */
+bool MidiOutput::open(const MidiConfig &config, double rate) {
+    sampleRate = rate;
+    path       = config.file;
+
+    if (!path.empty() && !std::ofstream(path, std::ios::binary)) {
+        std::cerr << "ERROR::MIDI::FILE_NOT_WRITABLE " << path << std::endl;
+        return false;
+    }
+
+    if (!config.port.empty()) {
+        try {
+            port.reset(new RtMidiOut(RtMidi::UNSPECIFIED, "Swarm Music"));
+
+            // a number connects to an existing port, such as a synth's, anything else is a name
+            if (std::all_of(config.port.begin(), config.port.end(), [](char c) { return std::isdigit((unsigned char) c); })) {
+                unsigned int number = std::stoul(config.port);
+                if (number >= port->getPortCount()) {
+                    std::cerr << "ERROR::MIDI::NO_PORT " << number << std::endl;
+                    port.reset();
+                    return false;
+                }
+
+                port->openPort(number, "Swarm Music");
+                std::cout << "MIDI: " << port->getPortName(number) << std::endl;
+            } else {
+                port->openVirtualPort(config.port);
+                std::cout << "MIDI: virtual port " << config.port << std::endl;
+            }
+        } catch (RtMidiError &error) {
+            error.printMessage();
+            port.reset();
+            return false;
+        }
+    }
+
+    for (int bank = 0; bank < VOICE_BANKS; ++bank) {
+        send(0, 0xC0 | bank, MIDI_PROGRAMS[bank], 0);
+    }
+
+    return true;
+}
+
+/**
+ * Send a note event, on its time
+ *
+ * @param const NoteEvent &event
+ * @return void
+ */
+void MidiOutput::play(const NoteEvent &event) {
+    long key      = std::lround(69.0 + 12.0 * std::log2(std::max(event.frequency, 1.0f) / 440.0));
+    long velocity = std::lround(event.velocity * 127.0f);
+
+    unsigned char note  = std::min(std::max(key, 0L), 127L);
+    unsigned char level = std::min(std::max(velocity, 1L), 127L);
+
+    if (event.type == NOTE_ON || event.type == NOTE_HOLD) {
+        unsigned char channel = event.bank;
+
+        press(event.time, channel, note, level);
+        sounding[event.note] = std::make_pair(channel, note);
+        return;
+    }
+
+    std::map<int, std::pair<unsigned char, unsigned char>>::iterator held = sounding.find(event.note);
+    if (held == sounding.end()) {
+        return;
+    }
+
+    unsigned char channel = held->second.first;
+    unsigned char playing = held->second.second;
+
+    if (event.type == NOTE_OFF) {
+        release(event.time, channel, playing, level);
+        sounding.erase(held);
+    } else if (note != playing) {
+        release(event.time, channel, playing, 64);
+        press(event.time, channel, note, level);
+        held->second.second = note;
+    } else {
+        send(event.time, 0xA0 | channel, note, level);
+    }
+}
+
+/**
+ * Release every sounding note, close the port and write the file
+ *
+ * @param unsigned long long frame Time the music stops
+ * @return bool False if the file couldn't be written
+ */
+bool MidiOutput::close(unsigned long long frame) {
+    for (const std::pair<const int, std::pair<unsigned char, unsigned char>> &held : sounding) {
+        release(frame, held.second.first, held.second.second, 64);
+    }
+    sounding.clear();
+
+    if (port) {
+        port->closePort();
+        port.reset();
+    }
+
+    return path.empty() || writeFile();
+}
+
+/**
+ * Start a note, again if the key is already sounding
+ *
+ * @param unsigned long long frame
+ * @param unsigned char channel
+ * @param unsigned char key
+ * @param unsigned char level
+ * @return void
+ */
+void MidiOutput::press(unsigned long long frame, unsigned char channel, unsigned char key, unsigned char level) {
+    send(frame, 0x90 | channel, key, level);
+    ++keys[channel][key];
+}
+
+/**
+ * Let go of a note, only stopping the key once nothing else is holding it
+ *
+ * @param unsigned long long frame
+ * @param unsigned char channel
+ * @param unsigned char key
+ * @param unsigned char level Release velocity
+ * @return void
+ */
+void MidiOutput::release(unsigned long long frame, unsigned char channel, unsigned char key, unsigned char level) {
+    if (keys[channel][key] > 0 && --keys[channel][key] == 0) {
+        send(frame, 0x80 | channel, key, level);
+    }
+}
+
+/**
+ * Send a channel message to the port and append it to the file track
+ *
+ * @param unsigned long long frame
+ * @param unsigned char status
+ * @param unsigned char data1
+ * @param unsigned char data2 Left out of program changes
+ * @return void
+ */
+void MidiOutput::send(unsigned long long frame, unsigned char status, unsigned char data1, unsigned char data2) {
+    bool program = (status & 0xF0) == 0xC0;
+
+    message.assign({status, data1});
+    if (!program) {
+        message.push_back(data2);
+    }
+
+    if (port) {
+        try {
+            port->sendMessage(&message);
+        } catch (RtMidiError &error) {
+            error.printMessage();
+        }
+    }
+
+    if (path.empty()) {
+        return;
+    }
+
+    // variable length delta time, seven bits a byte with the high bit set on all but the last
+    unsigned long long tick  = std::llround(frame / sampleRate * 1000000.0 / MIDI_FILE_TEMPO * MIDI_FILE_DIVISION);
+    unsigned long long delta = tick > trackTick ? tick - trackTick : 0;
+    trackTick = std::max(tick, trackTick);
+
+    unsigned char bytes[10];
+    int           count = 0;
+    do {
+        bytes[count++] = delta & 0x7F;
+        delta >>= 7;
+    } while (delta > 0);
+
+    while (count > 0) {
+        --count;
+        track.push_back(bytes[count] | (count > 0 ? 0x80 : 0x00));
+    }
+
+    track.insert(track.end(), message.begin(), message.end());
+}
+
+/**
+ * Write the track as a format 0 Standard MIDI File
+ *
+ * @return bool
+ */
+bool MidiOutput::writeFile() const {
+    std::vector<unsigned char> data = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6,
+        0, 0, 0, 1, // format 0, one track
+        MIDI_FILE_DIVISION >> 8, MIDI_FILE_DIVISION & 0xFF
+    };
+
+    std::vector<unsigned char> events = {
+        0x00, 0xFF, 0x51, 0x03, MIDI_FILE_TEMPO >> 16, (MIDI_FILE_TEMPO >> 8) & 0xFF, MIDI_FILE_TEMPO & 0xFF
+    };
+    events.insert(events.end(), track.begin(), track.end());
+    events.insert(events.end(), {0x00, 0xFF, 0x2F, 0x00});
+
+    unsigned long length = events.size();
+    data.insert(data.end(), {'M', 'T', 'r', 'k', (unsigned char) (length >> 24), (unsigned char) (length >> 16), (unsigned char) (length >> 8), (unsigned char) length});
+    data.insert(data.end(), events.begin(), events.end());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write((const char *) data.data(), data.size())) {
+        std::cerr << "ERROR::MIDI::FILE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "MIDI: " << track.size() << " bytes of events written to " << path << std::endl;
+
+    return true;
+}
@@ -0,0 +1,75 @@
+/**
+ * Sample accurate note scheduling between the control thread and the audio callback
+ *
+ * The control thread queues timestamped events ahead of time, the audio callback fires each
+ * one on its exact frame. Nothing on the audio side allocates, locks or reads globals
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <NoteScheduler.h>
+
+/**
+ * Queue an event, from the control thread
+ *
+ * Events must be queued in time order, late events fire at the start of the next buffer
+ *
+ * @param const NoteEvent &event
+ * @return bool False if the queue is full and the event was dropped
+ */
+bool NoteScheduler::schedule(const NoteEvent &event) {
+    return events.push(event);
+}
+
+/**
+ * @return unsigned long long Frames rendered by the audio callback so far
+ */
+unsigned long long NoteScheduler::getSampleTime() const {
+    return sampleTime.load(std::memory_order_acquire);
+}
+
+/**
+ * Render a buffer, firing due events on their frame, from the audio callback
+ *
+ * @param VoicePool &voices
+ * @param stk::StkFloat *samples Mono output
+ * @param unsigned int frames
+ * @return void
+ */
+void NoteScheduler::render(VoicePool &voices, stk::StkFloat *samples, unsigned int frames) {
+    unsigned long long now = sampleTime.load(std::memory_order_relaxed);
+
+    unsigned int frame = 0;
+    while (frame < frames) {
+        unsigned int until = frames;
+
+        const NoteEvent *event = events.peek();
+        if (event != NULL) {
+            if (event->time <= now + frame) {
+                fire(voices, *event);
+                events.discard();
+                continue;
+            }
+
+            if (event->time - now < frames) {
+                until = event->time - now;
+            }
+        }
+
+        voices.render(samples + frame, until - frame);
+        frame = until;
+    }
+
+    sampleTime.store(now + frames, std::memory_order_release);
+}
+
+void NoteScheduler::fire(VoicePool &voices, const NoteEvent &event) {
+    if (event.type == NOTE_ON || event.type == NOTE_HOLD) {
+        voices.noteOn(event.bank, event.note, event.frequency, event.velocity, event.time, event.type == NOTE_HOLD);
+    } else if (event.type == NOTE_CHANGE) {
+        voices.noteChange(event.note, event.frequency, event.velocity);
+    } else {
+        voices.noteOff(event.note, event.velocity);
+    }
+}
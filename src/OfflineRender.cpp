@@ -0,0 +1,214 @@
+/**
+ * Render a list of note events to a WAV file, faster than real time
+ *
+ * The piece is cut into segments rendered on separate threads, each with its own voice pool.
+ * A segment starts rendering early enough to pick up every note still sounding at its start,
+ * which is discarded, so it joins the previous segment without a gap in the notes. Legato notes
+ * can be held for minutes, those are restarted a little ahead of the segment with the pitch and
+ * velocity they had reached. The voices are the same STK instruments the audio callback plays,
+ * fed through the same NoteScheduler and copied to every channel as it does. Only the notes are
+ * rendered, not the partial bank of sonified agents
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <stk/FileWvOut.h>
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <OfflineRender.h>
+
+/**
+ * @param const std::vector<NoteEvent> &noteEvents Note ids must be small, they index a table
+ * @param unsigned long long length Frames to render
+ * @param int policy Voice stealing policy
+ */
+OfflineRender::OfflineRender(const std::vector<NoteEvent> &noteEvents, unsigned long long length, int policy) : events(noteEvents), frames(length), stealPolicy(policy) {
+    std::stable_sort(events.begin(), events.end(), [](const NoteEvent &a, const NoteEvent &b) {
+        return a.time < b.time;
+    });
+
+    for (const NoteEvent &event : events) {
+        if (event.note >= (int) noteStart.size()) {
+            noteStart.resize(event.note + 1, 0);
+            noteEnd.resize(event.note + 1, 0);
+        }
+
+        // a note is held until its NOTE_OFF, if there is one
+        if (event.type == NOTE_ON || event.type == NOTE_HOLD) {
+            noteStart[event.note] = event.time;
+            noteEnd[event.note]   = ULLONG_MAX;
+        } else if (event.type == NOTE_OFF) {
+            noteEnd[event.note] = event.time;
+        }
+    }
+}
+
+/**
+ * Frame to start rendering from for a segment starting at start
+ *
+ * Far enough back for released notes to ring out, and further if a note still held at the
+ * start began before that, by up to OFFLINE_SETTLE_SECONDS
+ *
+ * @param unsigned long long start
+ * @return unsigned long long
+ */
+unsigned long long OfflineRender::warmStart(unsigned long long start) const {
+    unsigned long long release  = VOICE_RELEASE * stk::Stk::sampleRate();
+    unsigned long long settle   = OFFLINE_SETTLE_SECONDS * stk::Stk::sampleRate();
+    unsigned long long warm     = start > release ? start - release : 0;
+    unsigned long long earliest = start > release + settle ? start - release - settle : 0;
+
+    for (size_t note = 0; note < noteStart.size(); ++note) {
+        if (noteStart[note] < warm && noteEnd[note] > start - std::min(start, release)) {
+            warm = std::max(noteStart[note], earliest);
+        }
+    }
+
+    return warm;
+}
+
+/**
+ * Render the frames from start to end into output
+ *
+ * @param VoicePool &voices Fresh pool, used by this segment only
+ * @param unsigned long long start
+ * @param unsigned long long end
+ * @param stk::StkFloat *output end - start frames
+ * @return void
+ */
+void OfflineRender::renderSegment(VoicePool &voices, unsigned long long start, unsigned long long end, stk::StkFloat *output) const {
+    unsigned long long warm  = warmStart(start);
+    unsigned long long total = end - warm;
+
+    NoteScheduler scheduler;
+    std::vector<stk::StkFloat> block(OFFLINE_BLOCK_FRAMES);
+
+    // the scheduler counts from the warm start
+    size_t index = std::lower_bound(events.begin(), events.end(), warm, [](const NoteEvent &event, unsigned long long time) {
+        return event.time < time;
+    }) - events.begin();
+
+    // notes held from before the warm start begin again on it, where they had got to
+    for (size_t note = 0; note < noteStart.size(); ++note) {
+        if (noteStart[note] >= warm || noteEnd[note] <= warm) {
+            continue;
+        }
+
+        for (size_t i = index; i-- > 0;) {
+            if (events[i].note == (int) note && events[i].type != NOTE_OFF) {
+                NoteEvent restart = events[i];
+                restart.time = 0;
+                restart.type = events[i].type == NOTE_CHANGE ? NOTE_HOLD : events[i].type;
+                scheduler.schedule(restart);
+                break;
+            }
+        }
+    }
+
+    unsigned long long rendered = 0;
+    while (rendered < total) {
+        unsigned long long until = std::min(rendered + OFFLINE_BLOCK_FRAMES, total);
+
+        // queue everything firing in this block, rendering less if the queue fills up
+        for (; index < events.size() && events[index].time - warm < until; ++index) {
+            NoteEvent shifted = events[index];
+            shifted.time -= warm;
+
+            if (!scheduler.schedule(shifted)) {
+                until = std::max(shifted.time, rendered + 1);
+                break;
+            }
+        }
+
+        scheduler.render(voices, block.data(), until - rendered);
+
+        // keep what falls inside the segment
+        for (unsigned long long frame = rendered; frame < until; ++frame) {
+            if (warm + frame >= start) {
+                output[warm + frame - start] = block[frame - rendered];
+            }
+        }
+
+        rendered = until;
+    }
+}
+
+/**
+ * Render the whole piece to a 16 bit WAV file
+ *
+ * Segments are rendered a round of threads at a time so memory stays bounded however long the
+ * piece. Voice pools are created and destroyed on this thread, as STK instruments register
+ * themselves in a shared list when constructed
+ *
+ * @param const std::string &path
+ * @param unsigned int channels Each gets the same mix, as from the audio callback
+ * @param int threads
+ * @return bool
+ */
+bool OfflineRender::write(const std::string &path, unsigned int channels, int threads) const {
+    stk::FileWvOut file;
+    try {
+        file.openFile(path, channels, stk::FileWrite::FILE_WAV, stk::Stk::STK_SINT16);
+    } catch (stk::StkError &error) {
+        error.printMessage();
+        return false;
+    }
+
+    threads = std::max(threads, 1);
+
+    unsigned long long segment = OFFLINE_SEGMENT_SECONDS * stk::Stk::sampleRate();
+    stk::StkFrames     mono;
+    stk::StkFrames     buffer;
+
+    for (unsigned long long round = 0; round < frames; round += segment * threads) {
+        unsigned long long roundEnd = std::min(round + segment * threads, frames);
+
+        std::vector<std::unique_ptr<VoicePool>> pools;
+        try {
+            for (unsigned long long start = round; start < roundEnd; start += segment) {
+                pools.emplace_back(new VoicePool());
+                pools.back()->setStealPolicy(stealPolicy);
+            }
+        } catch (stk::StkError &error) {
+            error.printMessage();
+            return false;
+        }
+
+        mono.resize(roundEnd - round, 1);
+        buffer.resize(roundEnd - round, channels);
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < pools.size(); ++i) {
+            unsigned long long start = round + i * segment;
+            unsigned long long end   = std::min(start + segment, roundEnd);
+
+            workers.emplace_back(&OfflineRender::renderSegment, this, std::ref(*pools[i]), start, end, &mono[start - round]);
+        }
+
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+
+        for (unsigned long long frame = 0; frame < roundEnd - round; ++frame) {
+            for (unsigned int channel = 0; channel < channels; ++channel) {
+                buffer(frame, channel) = mono[frame];
+            }
+        }
+
+        file.tick(buffer);
+
+        std::cout << "\rRendered " << (int) (roundEnd / stk::Stk::sampleRate()) << "s of "
+                  << (int) (frames / stk::Stk::sampleRate()) << "s" << std::flush;
+    }
+    std::cout << std::endl;
+
+    file.closeFile();
+
+    return true;
+}
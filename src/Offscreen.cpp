@@ -0,0 +1,220 @@
+/**
+ * Offscreen GL context and framebuffer for rendering without a display
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <glad/glad.h>
+
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <Offscreen.h>
+
+/**
+ * Create a surfaceless GL 3.3 core context, make it current and attach a framebuffer
+ *
+ * @param int width
+ * @param int height
+ */
+Offscreen::Offscreen(int width, int height) : width(width), height(height) {
+    if (!createContext()) {
+        return;
+    }
+
+    if (!createFramebuffer()) {
+        return;
+    }
+
+    pixels.resize(width * height * 4);
+}
+
+Offscreen::~Offscreen() {
+    if (framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colourBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+
+    if (display != nullptr) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+        if (context != nullptr) {
+            eglDestroyContext(display, context);
+        }
+
+        eglTerminate(display);
+    }
+}
+
+/**
+ * Prefer the Mesa surfaceless platform, which needs no display server or GPU device,
+ * and fall back to the default display
+ *
+ * @return bool
+ */
+bool Offscreen::createContext() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    if (getPlatformDisplay != NULL) {
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (eglDisplay == EGL_NO_DISPLAY) {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        std::cerr << "ERROR::OFFSCREEN::NO_EGL_DISPLAY" << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    const char *extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    if (extensions == NULL || strstr(extensions, "EGL_KHR_surfaceless_context") == NULL) {
+        std::cerr << "ERROR::OFFSCREEN::NO_SURFACELESS_CONTEXT" << std::endl;
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "ERROR::OFFSCREEN::NO_OPENGL_API" << std::endl;
+        return false;
+    }
+
+    EGLint configAttributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint    configCount = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        config = (EGLConfig) 0;
+    }
+
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT) {
+        std::cerr << "ERROR::OFFSCREEN::CONTEXT_NOT_CREATED" << std::endl;
+        return false;
+    }
+    context = eglContext;
+
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        std::cerr << "ERROR::OFFSCREEN::CONTEXT_NOT_CURRENT" << std::endl;
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @return bool
+ */
+bool Offscreen::createFramebuffer() {
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    glGenRenderbuffers(1, &colourBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colourBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourBuffer);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR::OFFSCREEN::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return false;
+    }
+
+    glViewport(0, 0, width, height);
+
+    return true;
+}
+
+bool Offscreen::isValid() const {
+    return !pixels.empty();
+}
+
+int Offscreen::getWidth() const {
+    return this->width;
+}
+
+int Offscreen::getHeight() const {
+    return this->height;
+}
+
+/**
+ * @return void
+ */
+void Offscreen::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+/**
+ * Read the framebuffer back and write it out, binary PPM for a .ppm path, raw RGBA otherwise
+ *
+ * Rows are written top to bottom
+ *
+ * @param const std::string &path
+ * @return bool
+ */
+bool Offscreen::writeFrame(const std::string &path) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR::OFFSCREEN::FILE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    bool ppm = path.size() > 4 && path.compare(path.size() - 4, 4, ".ppm") == 0;
+    if (ppm) {
+        file << "P6\n" << width << " " << height << "\n255\n";
+    }
+
+    std::vector<unsigned char> row(width * (ppm ? 3 : 4));
+    for (int y = height - 1; y >= 0; --y) {
+        const unsigned char *source = &pixels[y * width * 4];
+
+        if (ppm) {
+            for (int x = 0; x < width; ++x) {
+                row[x * 3]     = source[x * 4];
+                row[x * 3 + 1] = source[x * 4 + 1];
+                row[x * 3 + 2] = source[x * 4 + 2];
+            }
+        } else {
+            memcpy(row.data(), source, row.size());
+        }
+
+        file.write((const char *) row.data(), row.size());
+    }
+
+    return (bool) file;
+}
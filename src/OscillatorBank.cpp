@@ -0,0 +1,204 @@
+/**
+ * Bank of sine partials, one per sonified agent
+ *
+ * Each partial is a unit phasor rotated once per sample, which needs only multiplies and adds.
+ * Partials are advanced OSCILLATOR_LANES at a time with per-lane accumulators, so the inner
+ * loops have no cross-lane dependency and vectorise; lanes are summed once per frame at the end
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <OscillatorBank.h>
+
+const float TWO_PI       = 6.28318530718f;
+const float GOLDEN_ANGLE = 2.39996322973f;
+
+OscillatorBank::OscillatorBank() {
+    for (int i = 0; i < OSCILLATOR_MAX; ++i) {
+        // spread starting phases so the partials don't all peak together
+        real[i]              = cos(i * GOLDEN_ANGLE);
+        imaginary[i]         = sin(i * GOLDEN_ANGLE);
+        rotationReal[i]      = 1.0f;
+        rotationImaginary[i] = 0.0f;
+        gainLeft[i]          = 0.0f;
+        gainRight[i]         = 0.0f;
+        targetLeft[i]        = 0.0f;
+        targetRight[i]       = 0.0f;
+        stepLeft[i]          = 0.0f;
+        stepRight[i]         = 0.0f;
+    }
+}
+
+/**
+ * Partial targets to fill before publish(), control thread only
+ *
+ * @return PartialSet&
+ */
+PartialSet &OscillatorBank::write() {
+    return parameters.write();
+}
+
+/**
+ * @return void
+ */
+void OscillatorBank::publish() {
+    parameters.publish();
+}
+
+/**
+ * Take a new set of partial targets, partials beyond its count fade out
+ *
+ * @param const PartialSet &partials
+ * @return void
+ */
+void OscillatorBank::apply(const PartialSet &partials) {
+    count = std::min(std::max(partials.count, 0), OSCILLATOR_MAX);
+
+    float radiansPerHz = TWO_PI / stk::Stk::sampleRate();
+
+    for (int i = 0; i < count; ++i) {
+        float omega = partials.frequency[i] * radiansPerHz;
+        rotationReal[i]      = cos(omega);
+        rotationImaginary[i] = sin(omega);
+
+        // equal power pan
+        float angle = std::min(std::max(partials.pan[i], 0.0f), 1.0f) * TWO_PI / 4.0f;
+        targetLeft[i]  = partials.amplitude[i] * cos(angle);
+        targetRight[i] = partials.amplitude[i] * sin(angle);
+    }
+
+    for (int i = count; i < rendered; ++i) {
+        targetLeft[i]  = 0.0f;
+        targetRight[i] = 0.0f;
+    }
+
+    rendered = std::max(rendered, count);
+}
+
+/**
+ * Add the partials to an interleaved buffer, from the audio callback
+ *
+ * Gains ramp linearly to their targets over the buffer. Left and right go to the first two
+ * channels, a mono buffer gets both
+ *
+ * @param stk::StkFloat *output
+ * @param unsigned int frames
+ * @param unsigned int channels
+ * @return void
+ */
+void OscillatorBank::render(stk::StkFloat *output, unsigned int frames, unsigned int channels) {
+    if (parameters.update()) {
+        apply(parameters.read());
+    }
+
+    if (rendered == 0 || frames == 0) {
+        return;
+    }
+
+    for (int i = 0; i < rendered; ++i) {
+        stepLeft[i]  = (targetLeft[i] - gainLeft[i]) / frames;
+        stepRight[i] = (targetRight[i] - gainRight[i]) / frames;
+    }
+
+    while (frames > 0) {
+        unsigned int length = std::min(frames, (unsigned int) OSCILLATOR_BLOCK);
+
+        renderBlock(output, length, channels);
+
+        output += length * channels;
+        frames -= length;
+    }
+
+    // land exactly on the targets and pull the phasors back onto the unit circle
+    for (int i = 0; i < rendered; ++i) {
+        gainLeft[i]  = targetLeft[i];
+        gainRight[i] = targetRight[i];
+
+        float magnitude = 1.0f / sqrt(real[i] * real[i] + imaginary[i] * imaginary[i]);
+        real[i]      *= magnitude;
+        imaginary[i] *= magnitude;
+    }
+
+    // faded out partials stop costing anything
+    rendered = count;
+}
+
+/**
+ * @param stk::StkFloat *output
+ * @param unsigned int frames At most OSCILLATOR_BLOCK
+ * @param unsigned int channels
+ * @return void
+ */
+void OscillatorBank::renderBlock(stk::StkFloat *output, unsigned int frames, unsigned int channels) {
+    std::fill(mixLeft, mixLeft + frames * OSCILLATOR_LANES, 0.0f);
+    std::fill(mixRight, mixRight + frames * OSCILLATOR_LANES, 0.0f);
+
+    for (int first = 0; first < rendered; first += OSCILLATOR_LANES) {
+        float re[OSCILLATOR_LANES], im[OSCILLATOR_LANES];
+        float rotationRe[OSCILLATOR_LANES], rotationIm[OSCILLATOR_LANES];
+        float left[OSCILLATOR_LANES], right[OSCILLATOR_LANES];
+        float leftStep[OSCILLATOR_LANES], rightStep[OSCILLATOR_LANES];
+
+        // OSCILLATOR_MAX is a multiple of the lane count, lanes past rendered are silent
+        for (int lane = 0; lane < OSCILLATOR_LANES; ++lane) {
+            int i = first + lane;
+            bool sounding = i < rendered;
+
+            re[lane]         = real[i];
+            im[lane]         = imaginary[i];
+            rotationRe[lane] = rotationReal[i];
+            rotationIm[lane] = rotationImaginary[i];
+            left[lane]       = sounding ? gainLeft[i] : 0.0f;
+            right[lane]      = sounding ? gainRight[i] : 0.0f;
+            leftStep[lane]   = sounding ? stepLeft[i] : 0.0f;
+            rightStep[lane]  = sounding ? stepRight[i] : 0.0f;
+        }
+
+        for (unsigned int frame = 0; frame < frames; ++frame) {
+            float *mixL = mixLeft + frame * OSCILLATOR_LANES;
+            float *mixR = mixRight + frame * OSCILLATOR_LANES;
+
+            for (int lane = 0; lane < OSCILLATOR_LANES; ++lane) {
+                float rotated = re[lane] * rotationRe[lane] - im[lane] * rotationIm[lane];
+                im[lane] = re[lane] * rotationIm[lane] + im[lane] * rotationRe[lane];
+                re[lane] = rotated;
+
+                left[lane]  += leftStep[lane];
+                right[lane] += rightStep[lane];
+
+                mixL[lane] += im[lane] * left[lane];
+                mixR[lane] += im[lane] * right[lane];
+            }
+        }
+
+        for (int lane = 0; lane < OSCILLATOR_LANES; ++lane) {
+            int i = first + lane;
+
+            real[i]      = re[lane];
+            imaginary[i] = im[lane];
+            if (i < rendered) {
+                gainLeft[i]  = left[lane];
+                gainRight[i] = right[lane];
+            }
+        }
+    }
+
+    for (unsigned int frame = 0; frame < frames; ++frame) {
+        float sumLeft = 0.0f, sumRight = 0.0f;
+        for (int lane = 0; lane < OSCILLATOR_LANES; ++lane) {
+            sumLeft  += mixLeft[frame * OSCILLATOR_LANES + lane];
+            sumRight += mixRight[frame * OSCILLATOR_LANES + lane];
+        }
+
+        if (channels == 1) {
+            output[frame] += (sumLeft + sumRight) * 0.5f;
+        } else {
+            output[frame * channels]     += sumLeft;
+            output[frame * channels + 1] += sumRight;
+        }
+    }
+}
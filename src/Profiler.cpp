@@ -0,0 +1,198 @@
+/**
+ * In-app frame profiler, CPU time per phase and GPU time per draw pass
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+#include <Profiler.h>
+#include <Trace.h>
+
+Profiler::Profiler() {
+    glGenQueries(PROFILE_QUERY_FRAMES * PROFILE_PHASES, &queries[0][0]);
+
+    for (int i = 0; i < PROFILE_PHASES; ++i) {
+        cpuFrame[i] = 0.0f;
+
+        for (int j = 0; j < PROFILE_QUERY_FRAMES; ++j) {
+            issued[j][i] = false;
+        }
+
+        for (int j = 0; j < PROFILE_HISTORY; ++j) {
+            cpuHistory[i][j] = 0.0f;
+            gpuHistory[i][j] = 0.0f;
+        }
+    }
+}
+
+Profiler::~Profiler() {
+    glDeleteQueries(PROFILE_QUERY_FRAMES * PROFILE_PHASES, &queries[0][0]);
+}
+
+/**
+ * Start a frame, collecting the GPU timings of the frame that last used this query set,
+ * PROFILE_QUERY_FRAMES frames back
+ *
+ * A result the GPU hasn't got to yet is dropped rather than waited for, the frame keeps the
+ * last timing of that pass instead
+ *
+ * @return void
+ */
+void Profiler::beginFrame() {
+    int previous = (historyIndex + PROFILE_HISTORY - 1) % PROFILE_HISTORY;
+
+    for (int i = 0; i < PROFILE_PHASES; ++i) {
+        cpuFrame[i] = 0.0f;
+
+        float gpuTime = 0.0f;
+        if (issued[queryFrame][i]) {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[queryFrame][i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available) {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[queryFrame][i], GL_QUERY_RESULT, &elapsed);
+                gpuTime = elapsed / 1000000.0f;
+            } else {
+                gpuTime = gpuHistory[i][previous];
+            }
+
+            issued[queryFrame][i] = false;
+        }
+
+        gpuHistory[i][historyIndex] = gpuTime;
+    }
+}
+
+/**
+ * Push this frame's CPU timings to the history and move to the next query set
+ *
+ * @return void
+ */
+void Profiler::endFrame() {
+    for (int i = 0; i < PROFILE_PHASES; ++i) {
+        cpuHistory[i][historyIndex] = cpuFrame[i];
+    }
+
+    historyIndex = (historyIndex + 1) % PROFILE_HISTORY;
+    if (historyCount < PROFILE_HISTORY) {
+        ++historyCount;
+    }
+
+    queryFrame = (queryFrame + 1) % PROFILE_QUERY_FRAMES;
+}
+
+/**
+ * Start timing a phase, draw passes also start a GPU timer query
+ *
+ * Passes must not overlap, only one GL_TIME_ELAPSED query can be active at a time
+ *
+ * @param int phase
+ * @return void
+ */
+void Profiler::begin(int phase) {
+    started[phase] = Clock::now();
+
+    if (phase >= PROFILE_FIRST_PASS) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[queryFrame][phase]);
+    }
+}
+
+/**
+ * @param int phase
+ * @return void
+ */
+void Profiler::end(int phase) {
+    if (phase >= PROFILE_FIRST_PASS) {
+        glEndQuery(GL_TIME_ELAPSED);
+        issued[queryFrame][phase] = true;
+    }
+
+    Clock::duration elapsed = Clock::now() - started[phase];
+    cpuFrame[phase] += std::chrono::duration<float, std::milli>(elapsed).count();
+
+#ifdef SWARM_TRACE
+    // phases double as trace zones
+    int64_t end = Trace::now();
+    Trace::record(getPhaseName(phase), end - std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), end);
+#endif
+}
+
+int Profiler::getHistoryCount() const {
+    return this->historyCount;
+}
+
+/**
+ * Index of the oldest sample in the history rings
+ *
+ * @return int
+ */
+int Profiler::getHistoryOffset() const {
+    return historyCount < PROFILE_HISTORY ? 0 : historyIndex;
+}
+
+/**
+ * @param int phase
+ * @return const float* Ring of CPU times in milliseconds
+ */
+const float *Profiler::getCpuHistory(int phase) const {
+    return this->cpuHistory[phase];
+}
+
+/**
+ * GPU times lag the CPU times by PROFILE_QUERY_FRAMES frames
+ *
+ * @param int phase
+ * @return const float* Ring of GPU times in milliseconds
+ */
+const float *Profiler::getGpuHistory(int phase) const {
+    return this->gpuHistory[phase];
+}
+
+float Profiler::getCpuPercentile(int phase, float fraction) const {
+    return percentile(cpuHistory[phase], fraction);
+}
+
+float Profiler::getGpuPercentile(int phase, float fraction) const {
+    return percentile(gpuHistory[phase], fraction);
+}
+
+/**
+ * @param const float *history
+ * @param float fraction e.g. 0.99 for p99
+ * @return float
+ */
+float Profiler::percentile(const float *history, float fraction) const {
+    if (historyCount == 0) {
+        return 0.0f;
+    }
+
+    std::copy(history, history + historyCount, scratch);
+    float *nth = scratch + std::min(historyCount - 1, (int) (fraction * historyCount));
+    std::nth_element(scratch, nth, scratch + historyCount);
+
+    return *nth;
+}
+
+/**
+ * @param int phase
+ * @return const char*
+ */
+const char *Profiler::getPhaseName(int phase) {
+    switch (phase) {
+        case PROFILE_INPUT:           return "Input";
+        case PROFILE_UI:              return "UI";
+        case PROFILE_SIMULATION:      return "Simulation";
+        case PROFILE_MUSIC:           return "Music";
+        case PROFILE_DRAW_SCENE:      return "Scene";
+        case PROFILE_DRAW_AGENTS:     return "Agents";
+        case PROFILE_DRAW_ATTRACTORS: return "Attractors";
+        case PROFILE_DRAW_IMPOSTORS:  return "Impostors";
+        case PROFILE_DRAW_UI:         return "UI Render";
+        default:                      return "";
+    }
+}
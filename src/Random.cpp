@@ -0,0 +1,31 @@
+/**
+ * Shared random number generation, one generator per thread
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <Random.h>
+
+/**
+ * The calling thread's generator, seeded from the random device on first use
+ *
+ * Constructing a random device per number was the cost of the old per-file generators
+ *
+ * @return std::mt19937&
+ */
+std::mt19937 &randomGenerator() {
+    thread_local std::mt19937 generator(std::random_device{}());
+
+    return generator;
+}
+
+/**
+ * Reseed the calling thread's generator, for reproducible runs
+ *
+ * @param unsigned int seed
+ * @return void
+ */
+void seedRandom(unsigned int seed) {
+    randomGenerator().seed(seed);
+}
@@ -0,0 +1,170 @@
+/**
+ * Scene renderer shared by the window and the headless image mode
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+#include <Renderer.h>
+
+const float OLIVE_BLACK = 0.23529411764;
+
+/**
+ * Compile the shaders and create the meshes and uniform buffers
+ *
+ * Needs a current GL context, which must outlive the renderer
+ */
+Renderer::Renderer() :
+    shaderLight("./shaders/light.vs", "./shaders/light.fs"),
+    shaderLightSource("./shaders/lightSource.vs", "./shaders/lightSource.fs"),
+    shaderInstanced("./shaders/instanced.vs", "./shaders/instanced.fs"),
+    shaderImpostor("./shaders/impostor.vs", "./shaders/impostor.fs"),
+    cameraBuffer(sizeof(CameraBlock), CAMERA_BINDING),
+    cubeLightBuffer(sizeof(LightBlock), LIGHT_BINDING),
+    sceneLightBuffer(sizeof(LightBlock), LIGHT_BINDING) {
+    shaderLight.bindUniformBlock("Camera", CAMERA_BINDING);
+    shaderLight.bindUniformBlock("Light", LIGHT_BINDING);
+    shaderLightSource.bindUniformBlock("Camera", CAMERA_BINDING);
+    shaderInstanced.bindUniformBlock("Camera", CAMERA_BINDING);
+    shaderInstanced.bindUniformBlock("Light", LIGHT_BINDING);
+    shaderImpostor.bindUniformBlock("Camera", CAMERA_BINDING);
+    shaderImpostor.bindUniformBlock("Light", LIGHT_BINDING);
+
+    // impostors size themselves in the vertex shader
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    for (int i = 0; i < MESH_COUNT; ++i) {
+        meshes.get(i);
+    }
+
+    cubeModel = glm::mat4(1.0f);
+    cubeModel = glm::scale(cubeModel, glm::vec3(400.0f, 400.0f, 400.0f));
+
+    // light source cube
+    glm::vec3 lightPos = glm::vec3(0.0f, 420.0f, 0.0f);
+
+    float lightAmbient  = 0.2f;
+    float lightDiffuse  = 0.75f;
+    float lightSpecular = 1.0f;
+
+    lightModel = glm::mat4(1.0f);
+    lightModel = glm::translate(lightModel, lightPos);
+    lightModel = glm::scale(lightModel, glm::vec3(0.2f));
+
+    // the wire cube is lit with a full white light, agents and attractors with the scene light
+    cubeLightBuffer.update(LightBlock {
+        glm::vec4(lightPos, 1.0f),
+        glm::vec4(1.0f),
+        glm::vec4(1.0f),
+        glm::vec4(1.0f)
+    });
+
+    sceneLightBuffer.update(LightBlock {
+        glm::vec4(lightPos, 1.0f),
+        glm::vec4(glm::vec3(lightAmbient), 1.0f),
+        glm::vec4(glm::vec3(lightDiffuse), 1.0f),
+        glm::vec4(glm::vec3(lightSpecular), 1.0f)
+    });
+
+    lightSourceModelLocation = shaderLightSource.getUniformLocation("model");
+    lightModelLocation       = shaderLight.getUniformLocation("model");
+    lightAmbientLocation     = shaderLight.getUniformLocation("material.ambient");
+    lightDiffuseLocation     = shaderLight.getUniformLocation("material.diffuse");
+    lightSpecularLocation    = shaderLight.getUniformLocation("material.specular");
+    lightShininessLocation   = shaderLight.getUniformLocation("material.shininess");
+}
+
+Renderer::~Renderer() {
+    meshes.clear();
+}
+
+/**
+ * Clear the bound framebuffer and draw the cube, agents and attractors
+ *
+ * @param Swarm &swarm
+ * @param glm::vec3 cameraPosition
+ * @param int width
+ * @param int height
+ * @param float detailDistance Distance past which agents are drawn as sprites
+ * @param Profiler &profiler
+ * @return void
+ */
+void Renderer::draw(Swarm &swarm, glm::vec3 cameraPosition, int width, int height, float detailDistance, Profiler &profiler) {
+    const Mesh &wireCube = meshes.get(MESH_WIRE_CUBE);
+    const Mesh &cone     = meshes.get(MESH_CONE);
+    const Mesh &sphere   = meshes.get(MESH_SPHERE);
+    const Mesh &point    = meshes.get(MESH_POINT);
+
+    glEnable(GL_DEPTH_TEST);
+
+    glClearColor(OLIVE_BLACK, OLIVE_BLACK, OLIVE_BLACK, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view = glm::lookAt(cameraPosition,
+                        glm::vec3(0.0f, -80.0f, 0.0f),
+                        glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glm::mat4 projection;
+    projection = glm::perspective(glm::radians(45.0f), (float) width / (float) height, 0.1f, 2500.0f);
+
+    // screen pixels covered by one world unit at distance 1, for level of detail
+    float pixelsPerUnit = (float) height / (2.0f * tan(glm::radians(45.0f) / 2.0f));
+
+    cameraBuffer.update(CameraBlock {
+        view,
+        projection,
+        glm::transpose(glm::inverse(view))
+    });
+
+    profiler.begin(PROFILE_DRAW_SCENE);
+
+    shaderLightSource.use();
+    shaderLightSource.setMat4(lightSourceModelLocation, lightModel);
+
+    wireCube.draw();
+
+    shaderLight.use();
+
+    // for wire cube
+    cubeLightBuffer.bind();
+
+    // draw cube
+    shaderLight.setMat4(lightModelLocation, cubeModel);
+    shaderLight.setVec3(lightAmbientLocation,  glm::vec3(0.02f, 0.02f, 0.02f));
+    shaderLight.setVec3(lightDiffuseLocation,  glm::vec3(0.01f, 0.01f, 0.01f));
+    shaderLight.setVec3(lightSpecularLocation, glm::vec3(0.4f, 0.4f, 0.4f));
+    shaderLight.setFloat(lightShininessLocation, 0.078125f * 128);
+
+    wireCube.draw();
+
+    profiler.end(PROFILE_DRAW_SCENE);
+
+    // for agents and attractors
+    sceneLightBuffer.bind();
+
+    // draw agents and attractors, far agents as sprites
+    profiler.begin(PROFILE_DRAW_AGENTS);
+    swarm.selectAgentDetail(cameraPosition, detailDistance, pixelsPerUnit);
+
+    shaderInstanced.use();
+    swarm.drawAgents(shaderInstanced, cone);
+    profiler.end(PROFILE_DRAW_AGENTS);
+
+    profiler.begin(PROFILE_DRAW_ATTRACTORS);
+    swarm.drawAttractors(shaderInstanced, sphere);
+    profiler.end(PROFILE_DRAW_ATTRACTORS);
+
+    profiler.begin(PROFILE_DRAW_IMPOSTORS);
+    shaderImpostor.use();
+    shaderImpostor.setFloat("pixelsPerUnit", pixelsPerUnit);
+    swarm.drawAgentImpostors(shaderImpostor, point);
+    profiler.end(PROFILE_DRAW_IMPOSTORS);
+
+    glBindVertexArray(0);
+}
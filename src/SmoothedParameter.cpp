@@ -0,0 +1,88 @@
+/**
+ * A control value that ramps linearly to its targets instead of jumping
+ *
+ * Ramps are advanced a block at a time by whoever owns the value, which decides how often it
+ * is worth applying, so each parameter can update at its own rate
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+
+#include <SmoothedParameter.h>
+
+SmoothedParameter::SmoothedParameter() : value(0.0f), target(0.0f), step(0.0f), remaining(0), rampFrames(1) {}
+
+/**
+ * Length of the ramp to each new target, from the next target on
+ *
+ * @param long frames
+ * @return void
+ */
+void SmoothedParameter::setRamp(long frames) {
+    rampFrames = std::max(frames, 1L);
+}
+
+/**
+ * Ramp from the current value to a new one
+ *
+ * @param float newTarget
+ * @return void
+ */
+void SmoothedParameter::setTarget(float newTarget) {
+    if (newTarget == target) {
+        return;
+    }
+
+    target    = newTarget;
+    remaining = rampFrames;
+    step      = (target - value) / rampFrames;
+}
+
+/**
+ * Set the value at once, at the start of a note
+ *
+ * @param float newValue
+ * @return void
+ */
+void SmoothedParameter::jump(float newValue) {
+    value     = newValue;
+    target    = newValue;
+    step      = 0.0f;
+    remaining = 0;
+}
+
+/**
+ * Move along the ramp
+ *
+ * @param unsigned int frames
+ * @return bool Whether the value changed
+ */
+bool SmoothedParameter::advance(unsigned int frames) {
+    if (remaining <= 0) {
+        return false;
+    }
+
+    if ((long) frames >= remaining) {
+        value     = target;
+        remaining = 0;
+    } else {
+        value     += step * frames;
+        remaining -= frames;
+    }
+
+    return true;
+}
+
+float SmoothedParameter::getValue() const {
+    return this->value;
+}
+
+float SmoothedParameter::getTarget() const {
+    return this->target;
+}
+
+bool SmoothedParameter::isMoving() const {
+    return this->remaining > 0;
+}
@@ -8,12 +8,15 @@
 #include <glm/glm.hpp>
 #include <Shader.h>
 
-#include <random>
+#include <algorithm>
+#include <thread>
 #include <vector>
 
 #include <Agent.h>
 #include <Attractor.h>
+#include <Random.h>
 #include <Swarm.h>
+#include <Trace.h>
 #include <Triplet.h>
 
 const int FREEFORM       = 0;
@@ -31,17 +34,19 @@ const int SCALES         = 1;
  * @return float
  */
 float swarmRand() {
-    std::random_device randomDevice;
-    std::mt19937 generator(randomDevice());
     std::uniform_int_distribution<> distribution(0, 20);
 
-    return (float)distribution(generator);
+    return (float)distribution(randomGenerator());
 }
 
-Swarm::Swarm() : averagePosition(Triplet(0.0f, 0.0f, 0.0f)) {
+Swarm::Swarm() : averagePosition(Triplet(0.0f, 0.0f, 0.0f)), time(0.0f) {
     agents.reserve(MAX_SIZE);
+    agentInstances.reserve(MAX_SIZE);
+    impostorInstances.reserve(MAX_SIZE);
+    attractorInstances.reserve(MAX_ATTRACTORS);
     attractors.reserve(MAX_ATTRACTORS);
-    addAgents();
+
+    // agents are added separately with addAgents(), which can run off the main thread
 
     radiusRepulsion   = 20.0f;
     radiusOrientation = 50.0f;
@@ -56,6 +61,27 @@ int Swarm::getSize() const {
     return this->agents.size();
 }
 
+const std::vector<Agent> &Swarm::getAgents() const {
+    return this->agents;
+}
+
+const std::vector<Cluster> &Swarm::getClusters() const {
+    return this->clusters.get();
+}
+
+const SwarmAnalytics &Swarm::getAnalytics() const {
+    return this->analytics;
+}
+
+/**
+ * Agents pulled by each attractor in the last step
+ *
+ * @return const std::vector<Occupancy>&
+ */
+const std::vector<Occupancy> &Swarm::getOccupancy() const {
+    return this->occupancy;
+}
+
 int Swarm::getAttractorsCount() const {
     return this->attractors.size();
 }
@@ -120,6 +146,10 @@ Triplet Swarm::getAveragePosition() const {
     return this->averagePosition;
 }
 
+float Swarm::getTime() const {
+    return this->time;
+}
+
 void Swarm::addAgents() {
     for (int i = 0; i < MAX_SIZE; ++i) {
         Agent agent;
@@ -140,104 +170,223 @@ void Swarm::resetAttractors() {
     attractors.erase(attractors.begin(), attractors.end());
 }
 
-void Swarm::addAttractor(int pitch, unsigned int *VBO, unsigned int *EBO, unsigned int *VAO, int tone = -1) {
+void Swarm::addAttractor(int pitch, int tone = -1) {
     Attractor attractor(pitch, tone);
     attractors.push_back(attractor);
-    setupDrawAttractors(VBO, EBO, VAO);
 }
 
 void Swarm::swarm(float deltaTime) {
-    for (int i = 0, size = getSize(); i < size; ++i)     {
-        agents[i].step(agents, radiusRepulsion, radiusOrientation, radiusAttraction, blindAngle, maxForce);
+    TRACE_SCOPE("Swarm::swarm");
+
+    time += deltaTime;
+
+    {
+        TRACE_SCOPE("Swarm::step");
+        for (int i = 0, size = getSize(); i < size; ++i)     {
+            agents[i].step(agents, radiusRepulsion, radiusOrientation, radiusAttraction, blindAngle, maxForce, time);
+
+            float positionX = swarmMode == AVERAGE ? averagePosition.getX() + agents[i].getPosition().getX() : agents[i].getPosition().getX();
+            float positionY = swarmMode == AVERAGE ? averagePosition.getY() + agents[i].getPosition().getY() : agents[i].getPosition().getY();
+            float positionZ = swarmMode == AVERAGE ? averagePosition.getZ() + agents[i].getPosition().getZ() : agents[i].getPosition().getZ();
+
+            if (swarmMode == RANDOM) {
+                if (swarmRand() < 2) {
+                    averagePosition.setX(positionX);
+                }
+                if (swarmRand() < 2) {
+                    averagePosition.setY(positionY);
+                }
+                if (swarmRand() < 2) {
+                    averagePosition.setZ(positionZ);
+                }
+
+                continue;
+            }
 
-        float positionX = swarmMode == AVERAGE ? averagePosition.getX() + agents[i].getPosition().getX() : agents[i].getPosition().getX();
-        float positionY = swarmMode == AVERAGE ? averagePosition.getY() + agents[i].getPosition().getY() : agents[i].getPosition().getY();
-        float positionZ = swarmMode == AVERAGE ? averagePosition.getZ() + agents[i].getPosition().getZ() : agents[i].getPosition().getZ();
+            averagePosition.setX(positionX);
+            averagePosition.setY(positionY);
+            averagePosition.setZ(positionZ);
+        }
+    }
 
-        if (swarmMode == RANDOM) {
-            if (swarmRand() < 2) {
-                averagePosition.setX(positionX);
-            }
-            if (swarmRand() < 2) {
-                averagePosition.setY(positionY);
-            }
-            if (swarmRand() < 2) {
-                averagePosition.setZ(positionZ);
-            }
+    {
+        TRACE_SCOPE("Swarm::move");
 
-            continue;
+        occupancy.resize(attractors.size());
+        for (int i = 0, size = getAttractorsCount(); i < size; ++i) {
+            occupancy[i] = Occupancy {attractors[i].getPitch(), attractors[i].getStrength(), 0, 0.0f};
         }
 
-        averagePosition.setX(positionX);
-        averagePosition.setY(positionY);
-        averagePosition.setZ(positionZ);
-    }
+        // every slice starts from the step's begin(), so they all measure from the same reference
+        int slices = std::max((getSize() + SWARM_MOVE_SLICE - 1) / SWARM_MOVE_SLICE, 1);
+
+        analytics.begin();
+        sliceAnalytics.assign(slices, analytics);
+        sliceOccupancy.resize(slices);
+        for (std::vector<Occupancy> &counts : sliceOccupancy) {
+            counts = occupancy;
+        }
 
-    for (int i = 0, size = getSize(); i < size; ++i) {
-        agents[i].move(speed, attractors, deltaTime);
+        int threads = std::max(std::min((int) std::thread::hardware_concurrency(), slices), 1);
+
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; ++t) {
+            workers.emplace_back(&Swarm::moveSlices, this, t, threads, deltaTime);
+        }
+        moveSlices(0, threads, deltaTime);
+
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+
+        // merged in slice order, whichever thread moved them
+        for (int slice = 0; slice < slices; ++slice) {
+            analytics.merge(sliceAnalytics[slice]);
+
+            for (std::size_t i = 0; i < occupancy.size(); ++i) {
+                occupancy[i].agents       += sliceOccupancy[slice][i].agents;
+                occupancy[i].meanDistance += sliceOccupancy[slice][i].meanDistance;
+            }
+        }
+        analytics.end();
+
+        for (Occupancy &current : occupancy) {
+            if (current.agents > 0) {
+                current.meanDistance /= current.agents;
+            }
+        }
     }
 
     if (swarmMode == AVERAGE) {
         averagePosition.scalarDiv(getSize());
     }
-}
 
-void Swarm::setupDrawAgents(unsigned int *VBO, unsigned int *normalVBO, unsigned int *EBO, unsigned int *VAO) {
-    agents.at(0).setupDraw(VBO, normalVBO, EBO, VAO);
+    clusters.update(agents, radiusOrientation, speed);
 }
 
-void Swarm::setupDrawAttractors(unsigned int *VBO, unsigned int *EBO, unsigned int *VAO) {
-    attractors.at(0).setupDraw(VBO, EBO, VAO);
+/**
+ * Move every stride'th slice of agents from first, gathering stats as each lands in its new position
+ *
+ * Agents only read the attractors as they move, so slices can move on separate threads
+ *
+ * @param int first
+ * @param int stride
+ * @param float deltaTime
+ * @return void
+ */
+void Swarm::moveSlices(int first, int stride, float deltaTime) {
+    for (int slice = first, slices = sliceAnalytics.size(); slice < slices; slice += stride) {
+        SwarmAnalytics         &partial = sliceAnalytics[slice];
+        std::vector<Occupancy> &counts  = sliceOccupancy[slice];
+
+        for (int i = slice * SWARM_MOVE_SLICE, end = std::min(i + SWARM_MOVE_SLICE, getSize()); i < end; ++i) {
+            float distance;
+            int   attractor = agents[i].move(speed, attractors, deltaTime, &distance);
+            if (attractor >= 0) {
+                ++counts[attractor].agents;
+                counts[attractor].meanDistance += distance;
+            }
+
+            partial.add(agents[i]);
+        }
+    }
 }
 
-void Swarm::drawAgents(Shader shader) {
-    for (int i = 0, size = getSize(); i < size; ++i) {
-        glm::mat4 agentModel = glm::mat4(1.0f);
-        agents.at(i).transform(&agentModel);
+/**
+ * Pick a level of detail for every agent and fill the instance lists
+ *
+ * Agents further than detailDistance from the camera, or that would cover fewer than
+ * AGENT_MIN_PIXELS on screen, are drawn as point sprite impostors instead of cones
+ *
+ * @param glm::vec3 cameraPosition
+ * @param float detailDistance
+ * @param float pixelsPerUnit Screen pixels covered by one world unit at distance 1
+ * @return void
+ */
+void Swarm::selectAgentDetail(glm::vec3 cameraPosition, float detailDistance, float pixelsPerUnit) {
+    int size = getSize();
 
-        Triplet agentColour    = agents.at(i).getColour();
-        Triplet agentOldColour = agents.at(i).getOldColour();
+    agentInstances.resize(size);
+    impostorInstances.resize(size);
 
-        glm::vec3 agentColourVec    = glm::vec3(agentColour.getX(), agentColour.getY(), agentColour.getZ());
-        glm::vec3 agentOldColourVec = glm::vec3(agentOldColour.getX(), agentOldColour.getY(), agentOldColour.getZ());
+    // beyond this distance an agent is smaller than the pixel threshold
+    float pixelDistance = (AGENT_DRAW_SIZE * pixelsPerUnit) / AGENT_MIN_PIXELS;
+    float maxDistance   = std::min(detailDistance, pixelDistance);
+    float maxDistance2  = maxDistance * maxDistance;
 
-        glm::vec3 objColour = agentColourVec;
+    int near = 0, far = 0;
 
-        if (agentColourVec.x != agentOldColourVec.x) {
-            int swapTime = agents.at(i).getColourSwapTime();
-            objColour = glm::mix(agentOldColourVec, agentColourVec, (swapTime / 100.0f));
-            if (swapTime == 100) {
-                swapTime = -1;
-                agents.at(i).setOldColour(agentColour);
-            }
-            agents.at(i).setColourSwapTime(swapTime + 1);
+    for (int i = 0; i < size; ++i) {
+        Triplet position = agents[i].getPosition();
+        glm::vec3 offset = glm::vec3(position.getX(), position.getY(), position.getZ()) - cameraPosition;
+
+        if (glm::dot(offset, offset) > maxDistance2) {
+            agents[i].instance(&impostorInstances[far++]);
+        } else {
+            agents[i].instance(&agentInstances[near++]);
         }
+    }
 
-        shader.setMat4("model", agentModel);
-        shader.setVec3("material.ambient", objColour);
-        shader.setVec3("material.diffuse", objColour);
-        shader.setVec3("material.specular", glm::vec3(0.25f, 0.25f, 0.25f));
-        shader.setFloat("material.shininess", 32.0f);
+    agentInstances.resize(near);
+    impostorInstances.resize(far);
+}
 
-        agents.at(i).draw();
-    }
+/**
+ * Draw the agents selected for full detail in one instanced call
+ *
+ * Only reads agent state, colour fades are resolved in the shader from the simulation time
+ *
+ * @param const Shader &shader
+ * @param const Mesh &mesh
+ * @return void
+ */
+void Swarm::drawAgents(const Shader &shader, const Mesh &mesh) {
+    shader.setFloat("time", time);
+    shader.setFloat("fadeTime", COLOUR_FADE_TIME);
+    shader.setVec3("material.specular", glm::vec3(0.25f, 0.25f, 0.25f));
+    shader.setFloat("material.shininess", 32.0f);
+
+    mesh.drawInstanced(agentInstances.data(), agentInstances.size());
 }
 
-void Swarm::drawAttractors(Shader shader) {
-    if (getAttractorsCount() == 0) {
+/**
+ * Draw the remaining agents as oriented point sprites in one instanced call
+ *
+ * @param const Shader &shader
+ * @param const Mesh &mesh
+ * @return void
+ */
+void Swarm::drawAgentImpostors(const Shader &shader, const Mesh &mesh) {
+    shader.setFloat("time", time);
+    shader.setFloat("fadeTime", COLOUR_FADE_TIME);
+    shader.setFloat("agentSize", AGENT_DRAW_SIZE);
+
+    mesh.drawInstanced(impostorInstances.data(), impostorInstances.size());
+}
+
+/**
+ * Draw all attractors in one instanced call
+ *
+ * @param const Shader &shader
+ * @param const Mesh &mesh
+ * @return void
+ */
+void Swarm::drawAttractors(const Shader &shader, const Mesh &mesh) {
+    int size = getAttractorsCount();
+    if (size == 0) {
         return;
     }
 
-    for (int i = 0, size = getAttractorsCount(); i < size; ++i) {
-        glm::mat4 attractorModel = glm::mat4(1.0f);
-        attractors.at(i).transform(&attractorModel);
-
-        shader.setMat4("model", attractorModel);
-        shader.setVec3("material.ambient", glm::vec3(attractors.at(i).getColour().getX(), attractors.at(i).getColour().getY(), attractors.at(i).getColour().getZ()));
-        shader.setVec3("material.diffuse", glm::vec3(attractors.at(i).getColour().getX(), attractors.at(i).getColour().getY(), attractors.at(i).getColour().getZ()));
-        shader.setVec3("material.specular", glm::vec3(0.25f, 0.25f, 0.25f));
-        shader.setFloat("material.shininess", 32.0f);
+    attractorInstances.resize(size);
 
-        attractors.at(i).draw();
+    for (int i = 0; i < size; ++i) {
+        attractors[i].instance(&attractorInstances[i]);
     }
+
+    shader.setFloat("time", time);
+    shader.setFloat("fadeTime", COLOUR_FADE_TIME);
+    shader.setVec3("material.specular", glm::vec3(0.25f, 0.25f, 0.25f));
+    shader.setFloat("material.shininess", 32.0f);
+
+    mesh.drawInstanced(attractorInstances.data(), size);
 }
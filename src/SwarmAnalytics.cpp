@@ -0,0 +1,198 @@
+/**
+ * Order parameters and distributions of the swarm, gathered while it moves
+ *
+ * Agents are added one at a time from the loop that already moves them, so the stats cost no
+ * extra pass. Means and variances use Welford's update and partial sets merge with Chan's
+ * formula, so a split pass gives the same result as a single one
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <SwarmAnalytics.h>
+
+SwarmAnalytics::SwarmAnalytics() : polarisation(0.0f), milling(0.0f), centroid(0.0f, 0.0f, 0.0f), variance(0.0f, 0.0f, 0.0f), redRatio(0.0f) {
+    std::fill(&bins[0][0], &bins[0][0] + 3 * ANALYTICS_BINS, 0);
+
+    begin();
+}
+
+/**
+ * Start gathering a step
+ *
+ * @return void
+ */
+void SwarmAnalytics::begin() {
+    count = 0;
+    red   = 0;
+    blue  = 0;
+
+    reference[0] = centroid.getX();
+    reference[1] = centroid.getY();
+    reference[2] = centroid.getZ();
+
+    for (int axis = 0; axis < 3; ++axis) {
+        mean[axis]     = 0.0;
+        squares[axis]  = 0.0;
+        heading[axis]  = 0.0;
+        momentum[axis] = 0.0;
+    }
+
+    std::fill(&histogram[0][0], &histogram[0][0] + 3 * ANALYTICS_BINS, 0);
+}
+
+/**
+ * @param const Agent &agent
+ * @return void
+ */
+void SwarmAnalytics::add(const Agent &agent) {
+    Triplet position  = agent.getPosition();
+    Triplet direction = agent.getDirection();
+
+    double p[3] = {position.getX(), position.getY(), position.getZ()};
+    double d[3] = {direction.getX(), direction.getY(), direction.getZ()};
+
+    ++count;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        double delta = p[axis] - mean[axis];
+        mean[axis]    += delta / count;
+        squares[axis] += delta * (p[axis] - mean[axis]);
+        heading[axis] += d[axis];
+
+        int bin = (int) ((p[axis] + CUBE_HALF_SIZE) * ANALYTICS_BINS / (CUBE_HALF_SIZE * 2));
+        ++histogram[axis][std::min(std::max(bin, 0), ANALYTICS_BINS - 1)];
+    }
+
+    double r[3] = {p[0] - reference[0], p[1] - reference[1], p[2] - reference[2]};
+    momentum[0] += r[1] * d[2] - r[2] * d[1];
+    momentum[1] += r[2] * d[0] - r[0] * d[2];
+    momentum[2] += r[0] * d[1] - r[1] * d[0];
+
+    float colour = agent.getColour().getX();
+    if (colour == RED_R) {
+        ++red;
+    } else if (colour == BLUE_R) {
+        ++blue;
+    }
+}
+
+/**
+ * Fold in agents gathered separately since the same begin()
+ *
+ * @param const SwarmAnalytics &other
+ * @return void
+ */
+void SwarmAnalytics::merge(const SwarmAnalytics &other) {
+    if (other.count == 0) {
+        return;
+    }
+
+    long total = count + other.count;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        double delta = other.mean[axis] - mean[axis];
+        mean[axis]     += delta * other.count / total;
+        squares[axis]  += other.squares[axis] + delta * delta * count * other.count / total;
+        heading[axis]  += other.heading[axis];
+        momentum[axis] += other.momentum[axis];
+
+        for (int bin = 0; bin < ANALYTICS_BINS; ++bin) {
+            histogram[axis][bin] += other.histogram[axis][bin];
+        }
+    }
+
+    count  = total;
+    red   += other.red;
+    blue  += other.blue;
+}
+
+/**
+ * Turn the step's sums into results
+ *
+ * Polarisation is the length of the mean heading, 1 when every agent flies the same way.
+ * Milling is the angular momentum about the centroid over its largest possible value for the
+ * swarm's spread, near 1 when the swarm circles around its centre
+ *
+ * @return void
+ */
+void SwarmAnalytics::end() {
+    if (count == 0) {
+        polarisation = 0.0f;
+        milling      = 0.0f;
+        redRatio     = 0.0f;
+        return;
+    }
+
+    double spread2 = 0.0;
+    double h[3], c[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        h[axis]  = heading[axis] / count;
+        c[axis]  = mean[axis] - reference[axis];
+        spread2 += squares[axis] / count;
+    }
+
+    // move the momentum from the reference to the centroid
+    double l[3] = {
+        momentum[0] - (c[1] * heading[2] - c[2] * heading[1]),
+        momentum[1] - (c[2] * heading[0] - c[0] * heading[2]),
+        momentum[2] - (c[0] * heading[1] - c[1] * heading[0])
+    };
+
+    polarisation = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+    milling      = spread2 > 0.0 ? sqrt(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]) / (count * sqrt(spread2)) : 0.0f;
+    milling      = std::min(milling, 1.0f);
+
+    centroid = Triplet(mean[0], mean[1], mean[2]);
+    variance = Triplet(squares[0] / count, squares[1] / count, squares[2] / count);
+    redRatio = red + blue > 0 ? (float) red / (red + blue) : 0.0f;
+
+    std::copy(&histogram[0][0], &histogram[0][0] + 3 * ANALYTICS_BINS, &bins[0][0]);
+}
+
+float SwarmAnalytics::getPolarisation() const {
+    return this->polarisation;
+}
+
+float SwarmAnalytics::getMilling() const {
+    return this->milling;
+}
+
+Triplet SwarmAnalytics::getCentroid() const {
+    return this->centroid;
+}
+
+Triplet SwarmAnalytics::getVariance() const {
+    return this->variance;
+}
+
+/**
+ * Root mean square distance of the agents from the centroid
+ *
+ * @return float
+ */
+float SwarmAnalytics::getSpread() const {
+    return sqrt(variance.getX() + variance.getY() + variance.getZ());
+}
+
+/**
+ * Share of coloured agents that are red
+ *
+ * @return float
+ */
+float SwarmAnalytics::getRedRatio() const {
+    return this->redRatio;
+}
+
+/**
+ * Agent counts per bin along one axis, from the last step
+ *
+ * @param int axis 0 for x, 1 for y, 2 for z
+ * @return const int*
+ */
+const int *SwarmAnalytics::getHistogram(int axis) const {
+    return this->bins[axis];
+}
@@ -0,0 +1,138 @@
+/**
+ * Scoped trace zones written out as Chrome trace JSON (chrome://tracing, Perfetto)
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Trace.h>
+
+namespace {
+    const std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+
+    // buffers are registered once per thread and live until exit, so the exporter
+    // can read threads that have already finished
+    std::mutex                                buffersMutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+    thread_local TraceBuffer *threadBuffer = nullptr;
+
+    TraceBuffer *getThreadBuffer() {
+        if (threadBuffer == nullptr) {
+            std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+            buffer->count = 0;
+
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffer->threadId = buffers.size() + 1;
+            threadBuffer     = buffer.get();
+            buffers.push_back(std::move(buffer));
+        }
+
+        return threadBuffer;
+    }
+}
+
+/**
+ * @return int64_t Microseconds since start
+ */
+int64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - traceStart).count();
+}
+
+/**
+ * Append a complete event to the calling thread's buffer, over its oldest once the buffer is full
+ *
+ * @param const char *name Must outlive the trace, usually a string literal
+ * @param int64_t begin
+ * @param int64_t end
+ * @return void
+ */
+void Trace::record(const char *name, int64_t begin, int64_t end) {
+    TraceBuffer *buffer = getThreadBuffer();
+
+    int64_t index = buffer->count.load(std::memory_order_relaxed);
+
+    buffer->events[index % TRACE_BUFFER_EVENTS] = TraceEvent {name, begin, end - begin};
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * Name the calling thread in the exported timeline
+ *
+ * @param const char *name
+ * @return void
+ */
+void Trace::setThreadName(const char *name) {
+    TraceBuffer *buffer = getThreadBuffer();
+
+    // only this thread writes the name, cheap to call from every audio callback
+    if (buffer->threadName == name) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffer->threadName = name;
+}
+
+/**
+ * Write the last TRACE_BUFFER_EVENTS events of each thread as Chrome trace JSON
+ *
+ * Safe to call while other threads are still recording, their newer events are left out
+ *
+ * @param const char *path
+ * @return bool
+ */
+bool Trace::write(const char *path) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "ERROR::TRACE::FILE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    file << "{\"traceEvents\":[\n";
+
+    std::vector<TraceEvent> events;
+    events.reserve(TRACE_BUFFER_EVENTS);
+
+    bool first = true;
+    for (const std::unique_ptr<TraceBuffer> &buffer : buffers) {
+        if (!buffer->threadName.empty()) {
+            file << (first ? "" : ",\n")
+                 << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+            first = false;
+        }
+
+        int64_t count  = buffer->count.load(std::memory_order_acquire);
+        int64_t oldest = std::max(count - TRACE_BUFFER_EVENTS, (int64_t) 0);
+
+        events.clear();
+        for (int64_t i = oldest; i < count; ++i) {
+            events.push_back(buffer->events[i % TRACE_BUFFER_EVENTS]);
+        }
+
+        // the thread may have come round the ring onto the oldest events while they were copied
+        int64_t lapped = buffer->count.load(std::memory_order_acquire) - TRACE_BUFFER_EVENTS + 1;
+        int64_t skip   = std::min(std::max(lapped - oldest, (int64_t) 0), (int64_t) events.size());
+
+        for (std::vector<TraceEvent>::const_iterator event = events.begin() + skip; event != events.end(); ++event) {
+            file << (first ? "" : ",\n")
+                 << "{\"name\":\"" << event->name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << event->begin << ",\"dur\":" << event->duration << "}";
+            first = false;
+        }
+    }
+
+    file << "\n]}\n";
+
+    return true;
+}
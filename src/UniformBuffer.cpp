@@ -0,0 +1,60 @@
+/**
+ * A std140 uniform buffer object shared between shader programs
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <glad/glad.h>
+
+#include <UniformBuffer.h>
+
+UniformBuffer::UniformBuffer(std::size_t size, unsigned int binding) : binding(binding), size(size) {
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    bind();
+}
+
+UniformBuffer::~UniformBuffer() {
+    glDeleteBuffers(1, &id);
+}
+
+unsigned int UniformBuffer::getId() const {
+    return this->id;
+}
+
+unsigned int UniformBuffer::getBinding() const {
+    return this->binding;
+}
+
+/**
+ * Attach the whole buffer to its binding point
+ *
+ * Several buffers can share a binding point, the last one bound is the one programs read
+ *
+ * @return void
+ */
+void UniformBuffer::bind() const {
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+}
+
+/**
+ * Upload new contents to (part of) the buffer
+ *
+ * @param const void *data
+ * @param std::size_t length
+ * @param std::size_t offset
+ * @return void
+ */
+void UniformBuffer::update(const void *data, std::size_t length, std::size_t offset) const {
+    if (offset + length > size) {
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, length, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,262 @@
+/**
+ * Fixed pool of preallocated instrument voices with voice stealing
+ *
+ * Every instrument is created up front, one bank of VOICE_COUNT voices per instrument type,
+ * so starting, stopping and stealing voices on the audio thread never allocates
+ *
+ * @package Swarm Music
+ * @author Fernando Ferreira
+ */
+
+#include <stk/Bowed.h>
+#include <stk/Plucked.h>
+#include <stk/Saxofony.h>
+#include <stk/Sitar.h>
+#include <stk/StifKarp.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <VoicePool.h>
+
+/**
+ * Create every voice, throws stk::StkError if an instrument can't be created
+ */
+VoicePool::VoicePool() : stealPolicy(VOICE_STEAL_OLDEST), block(VOICE_BLOCK_FRAMES, 1) {
+    releaseLength = VOICE_RELEASE * stk::Stk::sampleRate();
+
+    for (int bank = 0; bank < VOICE_BANKS; ++bank) {
+        for (int i = 0; i < VOICE_COUNT; ++i) {
+            voices[bank][i].instrument.reset(createInstrument(bank));
+            voices[bank][i].frequency.setRamp(VOICE_GLIDE * stk::Stk::sampleRate());
+            voices[bank][i].gain.setRamp(VOICE_GAIN_RAMP * stk::Stk::sampleRate());
+        }
+    }
+}
+
+stk::Instrmnt *VoicePool::createInstrument(int bank) {
+    switch (bank) {
+        case BANK_BOWED:    return new stk::Bowed(VOICE_LOWEST_FREQUENCY);
+        case BANK_SAXOFONY: return new stk::Saxofony(VOICE_LOWEST_FREQUENCY);
+        case BANK_SITAR:    return new stk::Sitar(VOICE_LOWEST_FREQUENCY);
+        case BANK_STIFKARP: return new stk::StifKarp(VOICE_LOWEST_FREQUENCY);
+        default:            return new stk::Plucked(VOICE_LOWEST_FREQUENCY);
+    }
+}
+
+int VoicePool::getStealPolicy() const {
+    return this->stealPolicy.load(std::memory_order_relaxed);
+}
+
+/**
+ * @param int value VOICE_STEAL_OLDEST or VOICE_STEAL_QUIETEST
+ * @return void
+ */
+void VoicePool::setStealPolicy(int value) {
+    stealPolicy.store(value, std::memory_order_relaxed);
+}
+
+/**
+ * Pick a free voice in a bank, or steal one by the current policy
+ *
+ * Voices ringing out after their release go first, then notes still sounding, and notes held
+ * across steps only once there is nothing else, as the NOTE_CHANGEs gliding them would be lost
+ *
+ * @param int bank
+ * @return Voice*
+ */
+Voice *VoicePool::allocate(int bank) {
+    Voice *bankVoices = voices[bank];
+
+    for (int i = 0; i < VOICE_COUNT; ++i) {
+        if (!bankVoices[i].active) {
+            return &bankVoices[i];
+        }
+    }
+
+    int    policy = stealPolicy.load(std::memory_order_relaxed);
+    Voice *victim = &bankVoices[0];
+
+    for (int i = 1; i < VOICE_COUNT; ++i) {
+        const Voice &voice = bankVoices[i];
+
+        int rank       = voice.note < 0 ? 0 : voice.held ? 2 : 1;
+        int victimRank = victim->note < 0 ? 0 : victim->held ? 2 : 1;
+
+        if (rank != victimRank) {
+            if (rank < victimRank) {
+                victim = &bankVoices[i];
+            }
+        } else if (policy == VOICE_STEAL_QUIETEST ? voice.level < victim->level : voice.started < victim->started) {
+            victim = &bankVoices[i];
+        }
+    }
+
+    return victim;
+}
+
+/**
+ * @param int bank BANK_ constant
+ * @param int note Id used to release the note later
+ * @param float frequency
+ * @param float velocity
+ * @param unsigned long long time Start frame, orders voices for stealing
+ * @param bool hold Held across steps and glided by noteChange(), kept from stealing
+ * @return void
+ */
+void VoicePool::noteOn(int bank, int note, float frequency, float velocity, unsigned long long time, bool hold) {
+    if (bank < 0 || bank >= VOICE_BANKS) {
+        bank = BANK_PLUCKED;
+    }
+
+    Voice *voice = allocate(bank);
+
+    voice->instrument->noteOn(frequency, velocity);
+    voice->active   = true;
+    voice->note     = note;
+    voice->started  = time;
+    voice->release  = releaseLength;
+    voice->level    = velocity;
+    voice->velocity = std::max(velocity, 0.01f);
+    voice->held     = hold;
+
+    voice->frequency.jump(frequency);
+    voice->gain.jump(1.0f);
+}
+
+/**
+ * Release a note, ignored if its voice was stolen in the meantime
+ *
+ * @param int note
+ * @param float velocity
+ * @return void
+ */
+void VoicePool::noteOff(int note, float velocity) {
+    for (int bank = 0; bank < VOICE_BANKS; ++bank) {
+        for (int i = 0; i < VOICE_COUNT; ++i) {
+            Voice &voice = voices[bank][i];
+
+            if (voice.active && voice.note == note) {
+                voice.instrument->noteOff(velocity);
+                voice.note = -1;
+                voice.held = false;
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Glide a held note to a new frequency and velocity, ignored if its voice was stolen
+ *
+ * @param int note
+ * @param float frequency
+ * @param float velocity
+ * @return void
+ */
+void VoicePool::noteChange(int note, float frequency, float velocity) {
+    for (int bank = 0; bank < VOICE_BANKS; ++bank) {
+        for (int i = 0; i < VOICE_COUNT; ++i) {
+            Voice &voice = voices[bank][i];
+
+            if (voice.active && voice.note == note) {
+                voice.frequency.setTarget(frequency);
+                voice.gain.setTarget(velocity / voice.velocity);
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Mix every sounding voice into a buffer, overwriting it
+ *
+ * @param stk::StkFloat *samples Mono output
+ * @param unsigned int frames
+ * @return void
+ */
+void VoicePool::render(stk::StkFloat *samples, unsigned int frames) {
+    while (frames > 0) {
+        unsigned int length = std::min(frames, (unsigned int) VOICE_BLOCK_FRAMES);
+
+        renderBlock(samples, length);
+
+        samples += length;
+        frames  -= length;
+    }
+}
+
+/**
+ * Render each voice a block at a time through its StkFrames tick and accumulate, the plain
+ * loops over contiguous samples are left for the compiler to vectorise
+ *
+ * @param stk::StkFloat *samples
+ * @param unsigned int frames At most VOICE_BLOCK_FRAMES
+ * @return void
+ */
+void VoicePool::renderBlock(stk::StkFloat *samples, unsigned int frames) {
+    std::fill(samples, samples + frames, 0.0);
+
+    block.resize(frames, 1);
+    const stk::StkFloat *source = &block[0];
+
+    for (int bank = 0; bank < VOICE_BANKS; ++bank) {
+        for (int i = 0; i < VOICE_COUNT; ++i) {
+            Voice &voice = voices[bank][i];
+            if (!voice.active) {
+                continue;
+            }
+
+            if (voice.frequency.isMoving()) {
+                // the instrument is only retuned while gliding, every VOICE_CONTROL_FRAMES
+                for (unsigned int frame = 0; frame < frames; frame += VOICE_CONTROL_FRAMES) {
+                    unsigned int length = std::min(frames - frame, (unsigned int) VOICE_CONTROL_FRAMES);
+
+                    if (voice.frequency.advance(length)) {
+                        voice.instrument->setFrequency(voice.frequency.getValue());
+                    }
+
+                    for (unsigned int offset = 0; offset < length; ++offset) {
+                        block[frame + offset] = voice.instrument->tick();
+                    }
+                }
+            } else {
+                voice.instrument->tick(block);
+            }
+
+            // gain changes ramp across the block rather than stepping at its start
+            stk::StkFloat gain  = voice.gain.getValue() * VOICE_GAIN;
+            voice.gain.advance(frames);
+            stk::StkFloat slope = (voice.gain.getValue() * VOICE_GAIN - gain) / frames;
+
+            stk::StkFloat level = 0.0;
+            for (unsigned int frame = 0; frame < frames; ++frame) {
+                samples[frame] += source[frame] * (gain + slope * frame);
+                level = std::max(level, std::fabs(source[frame]));
+            }
+            voice.level = level;
+
+            // released voices ring out for a while, then go back to the pool
+            if (voice.note < 0) {
+                voice.release -= frames;
+                if (voice.release <= 0) {
+                    voice.active = false;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @return int Voices currently sounding
+ */
+int VoicePool::getActiveCount() const {
+    int count = 0;
+    for (int bank = 0; bank < VOICE_BANKS; ++bank) {
+        for (int i = 0; i < VOICE_COUNT; ++i) {
+            count += voices[bank][i].active ? 1 : 0;
+        }
+    }
+
+    return count;
+}
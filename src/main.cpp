@@ -10,17 +10,39 @@
 #include <Shader.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <future>
+#include <memory>
 #include <iomanip>
-#include <random>
 #include <thread>
 
 #include <Agent.h>
+#include <AudioDevice.h>
+#include <AudioMonitor.h>
+#include <BeatClock.h>
+#include <FrameCapture.h>
+#include <FramePacer.h>
+#include <Mesh.h>
+#include <MidiOutput.h>
+#include <NoteScheduler.h>
+#include <OscillatorBank.h>
+#include <OfflineRender.h>
+#include <Offscreen.h>
+#include <Profiler.h>
+#include <Random.h>
+#include <Renderer.h>
 #include <Scale.h>
 #include <Swarm.h>
+#include <Trace.h>
+#include <TripleBuffer.h>
 #include <Triplet.h>
+#include <UniformBuffer.h>
+#include <VoicePool.h>
 
-#include <stk/Plucked.h>
 #include <stk/RtAudio.h>
 #include <stk/Skini.h>
 
@@ -43,18 +65,15 @@
 #include "nuklear_glfw_gl3.h"
 
 struct TickData {
-    stk::Instrmnt *instrument;
-    stk::StkFloat frequency;
-    long counter;
-    bool done;
-
-    TickData()
-        : instrument(0), counter(0), done(false) {}
+    VoicePool                  voices;
+    NoteScheduler              scheduler;
+    OscillatorBank            *partials;
+    AudioMonitor              *monitor;
+    std::vector<stk::StkFloat> mono; // voices render here before being spread to every channel
+    unsigned int               channels;
 };
 
-const float CENTRAL_C      = 261.63;
 const float CUBE_SIZE_HALF = 400.0;
-const float OLIVE_BLACK    = 0.23529411764;
 const float PI             = 3.14159265;
 const float UPDATE_RATE    = 4.0;
 const int   DOOM           = 0;
@@ -62,10 +81,37 @@ const int   JAZZ           = 1;
 const int   POP            = 2;
 const int   METAL          = 3;
 const int   PUNK           = 4;
+// instrument bank per style, indexed by style
+const int   STYLE_BANKS[]  = {BANK_BOWED, BANK_SAXOFONY, BANK_PLUCKED, BANK_SITAR, BANK_STIFKARP};
+// styles whose lead note is held and glides from step to step, indexed by style
+const bool  STYLE_LEGATO[] = {true, true, false, false, false};
+// beats per minute per style, indexed by style
+const float STYLE_TEMPO[]  = {60.0f, 140.0f, 120.0f, 160.0f, 200.0f};
+// ticks between the grid lines notes land on per style, quarters for DOOM down to sixteenths
+const int   STYLE_GRID[]   = {BEAT_TICKS, BEAT_TICKS / 3, BEAT_TICKS / 2, BEAT_TICKS / 4, BEAT_TICKS / 4};
+// chance in percent of a voice playing on a grid step per style, indexed by style
+const float STYLE_CHANCE[] = {50.0f, 40.0f, 60.0f, 70.0f, 80.0f};
+const int   BAR_BEATS      = 4;
 const int   RANDOM         = 0;
 const int   AVERAGE        = 1;
 const int   C_MIDI_PITCH   = 72;
-const int   LENGTH_FACTOR  = 250;
+const char *RAWWAVE_PATH   = "./stk-4.6.0/rawwaves";
+const float PROBE_SECONDS  = 1.0f; // warm-up each buffer size runs for when probing
+const float PROBE_LOAD     = 0.5f; // highest p99 callback load a probed buffer size may have
+const int   PROBE_SIZES[]  = {64, 128, 256, 512, 1024, 2048}; // buffer sizes tried, in frames
+const int   PROBE_NOTE     = 1 << 30; // first id of the notes played while probing, clear of the music's
+const float PROBE_VELOCITY = 0.01f;   // probe notes cost as much as loud ones, but are barely heard
+const float PARTIAL_GAIN   = 0.3f;
+const int   CLUSTER_VOICES = 4; // largest clusters that get a note of their own each step
+const int   STEP_EVENTS    = CLUSTER_VOICES * 2 + 1; // most events one step can queue
+const int   PHRASE_POINTS  = 4; // predicted steps across a phrase, which is a bar
+const float PHRASE_MARGIN  = 0.1f; // seconds ahead of the audio clock a bar is worked out
+const int   PHRASE_BUFFERS = 4;    // the margin is never less than this many audio buffers
+const int   PHRASE_EVENTS  = NOTE_QUEUE_SIZE / 2; // most events one phrase can queue
+const float HARMONY_FLOOR  = 0.1f; // weight of an empty attractor next to its share of the agents
+const float CHORD_VELOCITY = 0.6f; // chord notes under the lead note
+const char *TRACE_PATH     = "./swarm-trace.json";
+const float EXIT_POLL      = 0.05f; // longest a music thread sleeps before checking for exit
 
 static float repulsionRadius   = 20.0f;
 static float orientationRadius = 50.0f;
@@ -73,12 +119,24 @@ static float attractionRadius  = 110.0f;
 static float blindAngle        = 10.0f;
 static float maxForce          = 30.7f;
 static float speed             = 30.5f;
+static float detailDistance    = 2500.0f;
 static int   scale             = 0;
 static int   style             = POP;
+static int   pacingMode        = PACING_HYBRID;
+static float spinTail          = 2.0f;
+static int   showProfiler      = 0;
+static int   showAnalytics     = 0;
+static int   recording         = 0;
+static int   captureFormat     = CAPTURE_Y4M;
+static int   stealPolicy       = VOICE_STEAL_OLDEST;
+static int   sonifyAgents      = 0;
+static float partialCount      = 256.0f;
 
 static unsigned int GUIpitch = 0;
 
-bool  canExit    = false;
+// read by the music thread, which is joined on exit
+std::atomic<bool> canExit {false};
+
 bool  mute       = false;
 float deltaTime  = 0.0f;
 float deltaSum   = 0.0f;
@@ -87,10 +145,60 @@ float lastFrame  = 0.0f;
 float theta      = 0.0f;
 int   frameCount = 0;
 
-float noteLength, velocity;
+// options for rendering frames to images without a display
+struct HeadlessOptions {
+    int          frames   = 600;
+    int          width    = 1280;
+    int          height   = 720;
+    float        timestep = 1.0f / 60.0f;
+    unsigned int seed     = 1;
+    int          pitch    = -1;
+    std::string  format   = "ppm";
+    std::string  output   = ".";
+    std::string  audio    = "";    // render the music to this WAV file instead of frames
+    float        duration = 60.0f; // seconds of music
+    int          threads  = 0;     // audio render threads, 0 for one per core
+};
+
+// startup phase durations in ms, reported once the first frame is shown
+std::vector<std::pair<std::string, float>> startupPhases;
+std::chrono::steady_clock::time_point      startupMark = std::chrono::steady_clock::now();
+
+// a note derived from a position in the cube
+struct MusicNote {
+    long  pitch;
+    float velocity;
+    float length;
+};
+
+// notes for the music thread, one per cluster
+struct MusicStep {
+    int       count = 0;
+    MusicNote notes[CLUSTER_VOICES];
+};
+
+// steps predicted evenly across the next phrase, the first one for when it starts playing
+struct MusicPhrase {
+    MusicStep steps[PHRASE_POINTS];
+};
+
+TripleBuffer<MusicPhrase> musicPhrases;
+
+// seconds between the music thread reading a phrase and the phrase starting to play
+std::atomic<float> phraseLead {0.0f};
+
+// lead note a legato style holds across steps
+struct HeldNote {
+    int note = -1; // id of its NOTE_HOLD, -1 when nothing is held
+    int bank = 0;
+};
+
 int   positionX;
-long  pitch;
 Swarm swarm;
+OscillatorBank partials;
+AudioMonitor   audioMonitor;
+AudioConfig    audioConfig;
+MidiConfig     midiConfig;
 
 /**
  * Random number generator
@@ -98,11 +206,9 @@ Swarm swarm;
  * @return float
  */
 float mainRand() {
-    std::random_device randomDevice;
-    std::mt19937 generator(randomDevice());
     std::uniform_int_distribution<> distribution(0, 100);
 
-    return (float) distribution(generator);
+    return (float) distribution(randomGenerator());
 }
 
 /**
@@ -112,7 +218,7 @@ float mainRand() {
  *
  * @return void
  */
-void makeScale(int givenPitch, unsigned int *VBO, unsigned int *EBO, unsigned int *VAO) {
+void makeScale(int givenPitch) {
     swarm.resetAttractors();
 
     int root      = givenPitch;
@@ -126,7 +232,7 @@ void makeScale(int givenPitch, unsigned int *VBO, unsigned int *EBO, unsigned in
     Scale attractorScale = Scale(root, scaleType);
 
     for (int i = 0, size = attractorScale.getPitches().size(); i < size; ++i) {
-        swarm.addAttractor(attractorScale.getPitches().at(i), VBO, EBO, VAO, attractorScale.getTones().at(i));
+        swarm.addAttractor(attractorScale.getPitches().at(i), attractorScale.getTones().at(i));
     }
 }
 
@@ -172,7 +278,7 @@ void slider(nk_context *context, const char *label, float min, float max, float
 void drawSwarmProperties(nk_context *context) {
     if (nk_begin(context,
                     "Swarm Properties",
-                    nk_rect(0, 0, 285, 155),
+                    nk_rect(0, 0, 285, 175),
                     NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_NO_SCROLLBAR
             )
         ) {
@@ -195,6 +301,9 @@ void drawSwarmProperties(nk_context *context) {
 
         // maximum force
         slider(context, "Force:", 10.1, 50.0, &maxForce, 0.1);
+
+        // distance past which agents are drawn as sprites
+        slider(context, "Detail:", 500.0, 2500.0, &detailDistance, 10.0);
     }
     nk_end(context);
 }
@@ -285,16 +394,13 @@ void resetButtonStyle(nk_context *context) {
  *
  * @param nk_glfw *glfw
  * @param nk_context *context
- * @param unsigned int *VBO
- * @param unsigned int *EBO
- * @param unsigned int *VAO
  *
  * @return void
  */
-void drawMusicalProperties(nk_glfw *glfw, nk_context *context, unsigned int *VBO, unsigned int *EBO, unsigned int *VAO) {
+void drawMusicalProperties(nk_glfw *glfw, nk_context *context) {
     if (nk_begin(context,
                     "Musical Properties",
-                    nk_rect(glfw->display_width - 285, 0, 285, 245),
+                    nk_rect(glfw->display_width - 285, 0, 285, 330),
                     NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_NO_SCROLLBAR
             )
         ) {
@@ -309,6 +415,14 @@ void drawMusicalProperties(nk_glfw *glfw, nk_context *context, unsigned int *VBO
 
         picker(context, stylePicker, &style, "Style:");
 
+        // which voice a new note takes once every voice is sounding
+        picker(context, {{"Oldest", VOICE_STEAL_OLDEST}, {"Quietest", VOICE_STEAL_QUIETEST}}, &stealPolicy, "Voice Stealing:");
+
+        // one sine partial per agent, on top of the notes
+        nk_layout_row_dynamic(context, 15, 1);
+        nk_checkbox_label(context, "Sonify Agents", &sonifyAgents);
+        slider(context, "Partials:", 8.0f, (float) OSCILLATOR_MAX, &partialCount, 8.0f);
+
         // swarm mode picker (won't use picker as this uses swarm.setSwarmMode)
         // it's also not terribly long
         nk_layout_row_dynamic(context, 15, 1);
@@ -336,12 +450,12 @@ void drawMusicalProperties(nk_glfw *glfw, nk_context *context, unsigned int *VBO
         // add attractor
         nk_layout_row_dynamic(context, 20, 2);
         if (nk_button_label(context, "Add Attractor")) {
-            swarm.addAttractor((int) GUIpitch + C_MIDI_PITCH, VBO, EBO, VAO, -1);
+            swarm.addAttractor((int) GUIpitch + C_MIDI_PITCH, -1);
         }
 
         // add scale
         if (nk_button_label(context, "Add Scale")) {
-            makeScale((int) GUIpitch + C_MIDI_PITCH, VBO, EBO, VAO);
+            makeScale((int) GUIpitch + C_MIDI_PITCH);
         }
 
         // mute (will override button style if muted)
@@ -373,24 +487,220 @@ void drawFPSDisplay(nk_glfw *glfw, nk_context *context) {
     nk_end(context);
 }
 
+/**
+ * Draw the display UI, frame pacing with the measured frame time jitter and recording
+ *
+ * @param nk_context *context
+ * @param const FramePacer &pacer
+ * @param const FrameCapture &capture
+ *
+ * @return void
+ */
+void drawDisplayProperties(nk_context *context, const FramePacer &pacer, const FrameCapture &capture) {
+    if (nk_begin(context,
+                    "Display",
+                    nk_rect(0, 180, 285, 225),
+                    NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_NO_SCROLLBAR
+            )
+        ) {
+        picker(context, {{"VSync", PACING_VSYNC}, {"Hybrid", PACING_HYBRID}, {"Uncapped", PACING_UNCAPPED}}, &pacingMode, "Pacing:");
+
+        // time spent spinning before the frame deadline, hybrid only
+        slider(context, "Spin (ms):", 0.0, 5.0, &spinTail, 0.1);
+
+        std::stringstream frameStream, jitterStream;
+        frameStream << std::fixed << std::setprecision(2)
+                    << "Frame: " << pacer.getMeanInterval() * 1000.0f << " ms"
+                    << "  Worst: " << pacer.getWorstInterval() * 1000.0f << " ms";
+        jitterStream << std::fixed << std::setprecision(2)
+                     << "Jitter: " << pacer.getJitter() * 1000.0f << " ms";
+
+        nk_layout_row_dynamic(context, 15, 1);
+        nk_label(context, frameStream.str().c_str(), NK_TEXT_LEFT);
+        nk_label(context, jitterStream.str().c_str(), NK_TEXT_LEFT);
+
+        nk_layout_row_dynamic(context, 15, 2);
+        nk_checkbox_label(context, "Profiler", &showProfiler);
+        nk_checkbox_label(context, "Analytics", &showAnalytics);
+
+        // recording, the format is fixed once started
+        if (!recording) {
+            picker(context, {{"Y4M", CAPTURE_Y4M}, {"Raw", CAPTURE_RAW}}, &captureFormat, "Record:");
+        } else {
+            std::stringstream captureStream;
+            captureStream << "Captured: " << capture.getCaptured() << "  Dropped: " << capture.getDropped();
+
+            nk_layout_row_dynamic(context, 15, 1);
+            nk_label(context, captureStream.str().c_str(), NK_TEXT_LEFT);
+        }
+
+        nk_layout_row_dynamic(context, 25, 1);
+        if (nk_button_label(context, recording ? "Stop" : "Record")) {
+            recording = !recording;
+        }
+    }
+    nk_end(context);
+}
+
+/**
+ * Draw the profiler, a rolling CPU (red) and GPU (grey) graph per phase with p99 values,
+ * then the audio callback load against its deadline
+ *
+ * @param nk_glfw *glfw
+ * @param nk_context *context
+ * @param const Profiler &profiler
+ * @param const AudioMonitor &monitor
+ *
+ * @return void
+ */
+void drawProfiler(nk_glfw *glfw, nk_context *context, const Profiler &profiler, const AudioMonitor &monitor) {
+    if (nk_begin(context,
+                    "Profiler",
+                    nk_rect(glfw->display_width - 285, 335, 285, 400),
+                    NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_MOVABLE | NK_WINDOW_MINIMIZABLE
+            )
+        ) {
+        int count  = profiler.getHistoryCount();
+        int offset = profiler.getHistoryOffset();
+
+        for (int phase = 0; phase < PROFILE_PHASES; ++phase) {
+            const float *cpu = profiler.getCpuHistory(phase);
+            const float *gpu = profiler.getGpuHistory(phase);
+
+            float cpu99 = profiler.getCpuPercentile(phase, 0.99f);
+            float gpu99 = profiler.getGpuPercentile(phase, 0.99f);
+
+            std::stringstream phaseStream;
+            phaseStream << std::fixed << std::setprecision(2) << Profiler::getPhaseName(phase)
+                        << "  p99 CPU: " << cpu99;
+            if (phase >= PROFILE_FIRST_PASS) {
+                phaseStream << " GPU: " << gpu99;
+            }
+
+            nk_layout_row_dynamic(context, 15, 1);
+            nk_label(context, phaseStream.str().c_str(), NK_TEXT_LEFT);
+
+            float max = std::max(std::max(cpu99, gpu99) * 1.5f, 0.1f);
+
+            nk_layout_row_dynamic(context, 30, 1);
+            if (nk_chart_begin_colored(context, NK_CHART_LINES, nk_rgb(255, 90, 95), nk_rgb(255, 90, 95), count, 0.0f, max)) {
+                if (phase >= PROFILE_FIRST_PASS) {
+                    nk_chart_add_slot_colored(context, NK_CHART_LINES, nk_rgb(175, 175, 175), nk_rgb(175, 175, 175), count, 0.0f, max);
+                }
+
+                for (int i = 0; i < count; ++i) {
+                    int sample = (offset + i) % PROFILE_HISTORY;
+
+                    nk_chart_push_slot(context, cpu[sample], 0);
+                    if (phase >= PROFILE_FIRST_PASS) {
+                        nk_chart_push_slot(context, gpu[sample], 1);
+                    }
+                }
+                nk_chart_end(context);
+            }
+        }
+
+        std::stringstream loadStream, xrunStream;
+        loadStream << std::fixed << std::setprecision(0)
+                   << "Audio  load: " << monitor.getLastLoad() * 100.0f << "%"
+                   << "  p99: " << monitor.getPercentile(0.99f) * 100.0f << "%"
+                   << "  worst: " << monitor.getWorstLoad() * 100.0f << "%";
+        xrunStream << "Underflows: " << monitor.getUnderflows() << "  Overruns: " << monitor.getOverruns();
+
+        nk_layout_row_dynamic(context, 15, 1);
+        nk_label(context, loadStream.str().c_str(), NK_TEXT_LEFT);
+        nk_label(context, xrunStream.str().c_str(), NK_TEXT_LEFT);
+
+        // share of callbacks per tenth of the buffer period, the last bars are past the deadline
+        unsigned int callbacks = std::max(monitor.getCallbacks(), 1u);
+
+        nk_layout_row_dynamic(context, 40, 1);
+        if (nk_chart_begin_colored(context, NK_CHART_COLUMN, nk_rgb(175, 175, 175), nk_rgb(255, 90, 95), AUDIO_LOAD_BINS, 0.0f, 1.0f)) {
+            for (int bin = 0; bin < AUDIO_LOAD_BINS; ++bin) {
+                nk_chart_push(context, (float) monitor.getBin(bin) / callbacks);
+            }
+            nk_chart_end(context);
+        }
+    }
+    nk_end(context);
+}
+
+/**
+ * Draw the swarm analytics, order parameters and where the agents are along each axis
+ *
+ * @param nk_context *context
+ * @param const SwarmAnalytics &analytics
+ *
+ * @return void
+ */
+void drawAnalytics(nk_context *context, const SwarmAnalytics &analytics) {
+    if (nk_begin(context,
+                    "Analytics",
+                    nk_rect(0, 410, 285, 265),
+                    NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_MOVABLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_NO_SCROLLBAR
+            )
+        ) {
+        std::stringstream orderStream, spreadStream;
+        orderStream << std::fixed << std::setprecision(2)
+                    << "Polarisation: " << analytics.getPolarisation()
+                    << "  Milling: " << analytics.getMilling();
+        spreadStream << std::fixed << std::setprecision(2)
+                     << "Spread: " << analytics.getSpread()
+                     << "  Red: " << analytics.getRedRatio() * 100.0f << "%";
+
+        nk_layout_row_dynamic(context, 15, 1);
+        nk_label(context, orderStream.str().c_str(), NK_TEXT_LEFT);
+        nk_label(context, spreadStream.str().c_str(), NK_TEXT_LEFT);
+
+        const char *axes[] = {"X:", "Y:", "Z:"};
+
+        for (int axis = 0; axis < 3; ++axis) {
+            const int *histogram = analytics.getHistogram(axis);
+
+            nk_layout_row_dynamic(context, 15, 1);
+            nk_label(context, axes[axis], NK_TEXT_LEFT);
+
+            nk_layout_row_dynamic(context, 40, 1);
+            if (nk_chart_begin_colored(context, NK_CHART_COLUMN, nk_rgb(8, 126, 139), nk_rgb(255, 90, 95), ANALYTICS_BINS, 0.0f, 1.0f)) {
+                int peak = *std::max_element(histogram, histogram + ANALYTICS_BINS);
+                for (int bin = 0; bin < ANALYTICS_BINS; ++bin) {
+                    nk_chart_push(context, peak > 0 ? (float) histogram[bin] / peak : 0.0f);
+                }
+                nk_chart_end(context);
+            }
+        }
+    }
+    nk_end(context);
+}
+
 /**
  * Draw the UI elements
  *
  * @param nk_glfw *glfw
  * @param nk_context *context
- * @param unsigned int *VBO
- * @param unsigned int *EBO
- * @param unsigned int *VAO
+ * @param const FramePacer &pacer
+ * @param const FrameCapture &capture
+ * @param const Profiler &profiler
  *
  * @return void
  */
-void drawUI(nk_glfw *glfw, nk_context *context, unsigned int *VBO, unsigned int *EBO, unsigned int *VAO) {
+void drawUI(nk_glfw *glfw, nk_context *context, const FramePacer &pacer, const FrameCapture &capture, const Profiler &profiler) {
     // to control the swarm properties
     context->style.window.fixed_background.data.color.a = 255;
 
     drawSwarmProperties(context);
 
-    drawMusicalProperties(glfw, context, VBO, EBO, VAO);
+    drawDisplayProperties(context, pacer, capture);
+
+    drawMusicalProperties(glfw, context);
+
+    if (showProfiler) {
+        drawProfiler(glfw, context, profiler, audioMonitor);
+    }
+
+    if (showAnalytics) {
+        drawAnalytics(context, swarm.getAnalytics());
+    }
 
     context->style.window.fixed_background.data.color.a = 0;
 
@@ -428,56 +738,6 @@ void setProperties() {
     }
 }
 
-/**
- * Setup wire cure
- *
- * @return void
- */
-void setupWireCube(unsigned int *VBO, unsigned int *EBO, unsigned int *VAO) {
-    // cube vertices
-    float vertices[] = {
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f, -1.0f,
-         1.0f,  1.0f,  1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f,  1.0f,
-    };
-
-    unsigned int indices[] = {
-        0, 1,
-        1, 3,
-        3, 2,
-        2, 0,
-        0, 4,
-        1, 5,
-        2, 6,
-        3, 7,
-        4, 5,
-        5, 7,
-        7, 6,
-        6, 4,
-    };
-
-    glGenBuffers(1, VBO);
-    glGenBuffers(1, EBO);
-    glGenVertexArrays(1, VAO);
-
-    glBindVertexArray(*VAO);
-
-    // vertices and colour
-    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*) 0);
-    glEnableVertexAttribArray(0);
-}
-
 void processInput(GLFWwindow* window) {
     // LEFT
     if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
@@ -512,6 +772,17 @@ void processInput(GLFWwindow* window) {
     if (glfwGetKey(window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS) {
         swarm.resetAttractors();
     }
+
+    // F12 to write the trace recorded so far, once per press
+    static bool tracePressed = false;
+    if (glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS) {
+        if (!tracePressed) {
+            TRACE_WRITE(TRACE_PATH);
+        }
+        tracePressed = true;
+    } else {
+        tracePressed = false;
+    }
 }
 
 int tick(
@@ -522,120 +793,585 @@ int tick(
     RtAudioStreamStatus status,
     void *userData
 ) {
+    TRACE_THREAD("Audio");
+    TRACE_SCOPE("tick");
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
     TickData *data = reinterpret_cast<TickData *>(userData);
 
-    register stk::StkFloat *samples = (stk::StkFloat *) outputBuffer;
+    stk::StkFloat *output = (stk::StkFloat *) outputBuffer;
+    stk::StkFloat *mono   = data->mono.data();
+
+    data->scheduler.render(data->voices, mono, nBufferFrames);
 
     for (unsigned int i = 0; i < nBufferFrames; ++i) {
-        *samples++ = data->instrument->tick();
-        if (++data->counter % 2000 == 0) {
-            data->instrument->setFrequency(data->frequency);
+        for (unsigned int channel = 0; channel < data->channels; ++channel) {
+            output[i * data->channels + channel] = mono[i];
         }
     }
 
-    // if DOOM or BLUES, 200. if JAZZ or METAL, 100. if PUNK, 50. Default 110
-    int lengthFactor = (style == DOOM || style == BLUES) ? 200 : (style == JAZZ || style == METAL) ? 100 : (style == PUNK) ? 50 : 110;
+    data->partials->render(output, nBufferFrames, data->channels);
 
-    if (data->counter > noteLength * lengthFactor) {
-        data->done = true;
-    }
+    data->monitor->record(started, nBufferFrames, stk::Stk::sampleRate(), (status & RTAUDIO_OUTPUT_UNDERFLOW) != 0);
 
     return 0;
 }
 
 /**
- * Compute notes to play
+ * Map a position in the cube to a note
  *
- * @return void
+ * @param Triplet position
+ * @return MusicNote
  */
-void playMusic() {
+MusicNote positionNote(Triplet position) {
+    MusicNote note;
+
     // x coordinate determines pitch between C4=72 and C6=96,
     // for a range of 2 octaves
-    pitch = ((swarm.getAveragePosition().getX() + CUBE_SIZE_HALF) * 25) / (CUBE_SIZE_HALF * 2);
-    if (pitch < 0) {
-        pitch = 0;
-    } else if (pitch > 25) {
-        pitch = 25;
+    note.pitch = ((position.getX() + CUBE_SIZE_HALF) * 25) / (CUBE_SIZE_HALF * 2);
+    if (note.pitch < 0) {
+        note.pitch = 0;
+    } else if (note.pitch > 25) {
+        note.pitch = 25;
     }
-    pitch += 72;
+    note.pitch += 72;
 
     // y coordinate determines velocity ("volume" at which individual note is played)
     // 0.0 to 1.0
-    velocity = ((swarm.getAveragePosition().getY() + CUBE_SIZE_HALF)) / (CUBE_SIZE_HALF * 2);
-    if (velocity < 0) {
-        velocity = 0;
-    } else if (velocity > 1.0) {
-        velocity = 1.0;
+    note.velocity = ((position.getY() + CUBE_SIZE_HALF)) / (CUBE_SIZE_HALF * 2);
+    if (note.velocity < 0) {
+        note.velocity = 0;
+    } else if (note.velocity > 1.0) {
+        note.velocity = 1.0;
     }
 
-    // z coordinate determines note length in ms
-    noteLength = ((swarm.getAveragePosition().getZ() + CUBE_SIZE_HALF)) / (CUBE_SIZE_HALF * 2);
-    noteLength = noteLength * LENGTH_FACTOR * deltaTime;
+    // z coordinate determines note length, from a grid step to a bar
+    // 0.0 to 1.0
+    note.length = ((position.getZ() + CUBE_SIZE_HALF)) / (CUBE_SIZE_HALF * 2);
+    if (note.length < 0) {
+        note.length = 0;
+    } else if (note.length > 1.0) {
+        note.length = 1.0;
+    }
+
+    return note;
 }
 
 /**
- * The music thread
+ * Move a note onto the attractors' scale, favouring the degrees the agents crowd around
+ *
+ * Each attractor scores its share of the agents times its harmonic strength, falling off with
+ * the distance from the note in semitones. Empty attractors still count a little so a note
+ * is never left off the scale
+ *
+ * @param long pitch
+ * @param const std::vector<Occupancy> &occupancy
+ * @return long
+ */
+long harmonise(long pitch, const std::vector<Occupancy> &occupancy) {
+    int agents = 0;
+    for (const Occupancy &current : occupancy) {
+        agents += current.agents;
+    }
+
+    long  best      = pitch;
+    float bestScore = 0.0f;
+
+    for (const Occupancy &current : occupancy) {
+        float share = agents > 0 ? (float) current.agents / agents : 0.0f;
+        float score = (share + HARMONY_FLOOR) * current.strength / (1.0f + std::abs(pitch - current.pitch));
+
+        if (score > bestScore) {
+            best      = current.pitch;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Notes the swarm is expected to play some time ahead
  *
+ * Each of the largest clusters plays its own note, so separate flocks don't average out into
+ * one note in the middle of the cube. Without clusters the average position plays. Clusters
+ * are carried along their current velocity, flocks turn slowly enough for a straight line to
+ * hold over a phrase
+ *
+ * @param float ahead Seconds
+ * @param const std::vector<Occupancy> &crowded Most crowded attractors first
+ * @param MusicStep *step
  * @return void
  */
-void music() {
-    stk::Stk::setSampleRate(44100.0);
-    stk::Stk::setRawwavePath("./stk-4.6.0/rawwaves");
+void predictStep(float ahead, const std::vector<Occupancy> &crowded, MusicStep *step) {
+    const std::vector<Cluster> &clusters = swarm.getClusters();
+
+    if (clusters.empty()) {
+        step->notes[0] = positionNote(swarm.getAveragePosition());
+        step->count    = 1;
+    } else {
+        step->count = std::min((int) clusters.size(), CLUSTER_VOICES);
+        for (int i = 0; i < step->count; ++i) {
+            Triplet position = clusters[i].centroid;
+            Triplet drift    = clusters[i].velocity;
+            drift.scalarMul(ahead);
+
+            step->notes[i] = positionNote(position + drift);
+        }
+    }
 
-    TickData data;
-    RtAudio dac;
+    // notes land on the scale, and voices left over play the most crowded degrees as a chord
+    if (!crowded.empty()) {
+        for (int i = 0; i < step->count; ++i) {
+            step->notes[i].pitch = harmonise(step->notes[i].pitch, crowded);
+        }
 
-    RtAudio::StreamParameters parameters;
-    
-    parameters.deviceId  = dac.getDefaultOutputDevice();
-    parameters.nChannels = 1;
+        for (const Occupancy &current : crowded) {
+            if (step->count >= CLUSTER_VOICES || current.agents == 0) {
+                break;
+            }
 
-    RtAudioFormat format           = (sizeof(stk::StkFloat) == 8) ? RTAUDIO_FLOAT64 : RTAUDIO_FLOAT32;
-    unsigned      int bufferFrames = stk::RT_BUFFER_SIZE;
+            bool playing = false;
+            for (int i = 0; i < step->count; ++i) {
+                playing = playing || step->notes[i].pitch == current.pitch;
+            }
+            if (playing) {
+                continue;
+            }
 
-    try {
-        dac.openStream(&parameters, NULL, format, (unsigned int) stk::Stk::sampleRate(), &bufferFrames, &tick, (void *) &data);
-    } catch (RtAudioError &error) {
-        error.printMessage();
-        return;
+            step->notes[step->count] = MusicNote {current.pitch, step->notes[0].velocity * CHORD_VELOCITY, step->notes[0].length};
+            ++step->count;
+        }
     }
 
-    try {
-        data.instrument = new stk::Plucked(CENTRAL_C);
-    } catch (stk::StkError &) {
-        delete data.instrument;
-        return;
+    // an aligned swarm plays out, a disordered one plays softer
+    float accent = 0.5f + 0.5f * swarm.getAnalytics().getPolarisation();
+    for (int i = 0; i < step->count; ++i) {
+        step->notes[i].velocity *= accent;
+    }
+}
+
+/**
+ * Compute notes to play over the next phrase
+ *
+ * @param float lead Seconds from now until the phrase starts playing
+ * @return void
+ */
+void playMusic(float lead) {
+    MusicPhrase &phrase = musicPhrases.write();
+
+    std::vector<Occupancy> crowded(swarm.getOccupancy());
+    std::sort(crowded.begin(), crowded.end(), [](const Occupancy &a, const Occupancy &b) {
+        return a.agents > b.agents;
+    });
+
+    float bar = BAR_BEATS * 60.0f / STYLE_TEMPO[style];
+    for (int i = 0; i < PHRASE_POINTS; ++i) {
+        predictStep(lead + bar * i / PHRASE_POINTS, crowded, &phrase.steps[i]);
+    }
+
+    musicPhrases.publish();
+}
+
+/**
+ * Map agents to sine partials, with the same axes as playMusic()
+ *
+ * x sets the pitch across the same two octaves, but continuously, y sets the amplitude and
+ * z the pan
+ *
+ * @return void
+ */
+void playPartials() {
+    PartialSet &set = partials.write();
+
+    const std::vector<Agent> &agents = swarm.getAgents();
+
+    int wanted = (sonifyAgents && !mute) ? std::min((int) partialCount, OSCILLATOR_MAX) : 0;
+    int count  = std::min(wanted, (int) agents.size());
+
+    // spread the chosen agents over the whole swarm
+    float stride = count > 0 ? (float) agents.size() / count : 0.0f;
+    float gain   = count > 0 ? PARTIAL_GAIN / sqrt((float) count) : 0.0f;
+
+    for (int i = 0; i < count; ++i) {
+        Triplet position = agents[(int) (i * stride)].getPosition();
+
+        float x = std::min(std::max((position.getX() + CUBE_SIZE_HALF) / (CUBE_SIZE_HALF * 2), 0.0f), 1.0f);
+        float y = std::min(std::max((position.getY() + CUBE_SIZE_HALF) / (CUBE_SIZE_HALF * 2), 0.0f), 1.0f);
+        float z = std::min(std::max((position.getZ() + CUBE_SIZE_HALF) / (CUBE_SIZE_HALF * 2), 0.0f), 1.0f);
+
+        float note = C_MIDI_PITCH + x * 25.0f;
+
+        set.frequency[i] = 440.0f * pow(2.0f, (note - 69.0f) / 12.0f);
+        set.amplitude[i] = y * gain;
+        set.pan[i]       = z;
+    }
+    set.count = count;
+
+    partials.publish();
+}
+
+/**
+ * Note events for one step of the music
+ *
+ * Notes start and end on the style's grid, so every event falls on a frame the beat clock
+ * worked out in advance
+ *
+ * @param const MusicStep &step
+ * @param unsigned long long next Frame the step starts on, on the grid
+ * @param const BeatClock &clock
+ * @param int *note Id for the next note, advanced for every note played
+ * @param HeldNote *held Lead note held by legato styles, carried from step to step
+ * @param NoteEvent *events Room for STEP_EVENTS events
+ * @param int *count Events written
+ *
+ * @return unsigned long long Frames until the next step
+ */
+unsigned long long stepEvents(const MusicStep &step, unsigned long long next, const BeatClock &clock, int *note, HeldNote *held, NoteEvent *events, int *count) {
+    int grid  = STYLE_GRID[style];
+    int cells = clock.getBeatsPerBar() * BEAT_TICKS / grid;
+
+    *count = 0;
+
+    // a held note ends once its style stops holding notes or the music is muted
+    bool legato = STYLE_LEGATO[style] && !mute;
+    if (held->note >= 0 && (!legato || held->bank != STYLE_BANKS[style])) {
+        events[(*count)++] = NoteEvent {next, NOTE_OFF, held->note, held->bank, 0.0f, 0.5f};
+        held->note = -1;
+    }
+
+    // the largest cluster sets the pace, the others play alongside it
+    unsigned long long length = 1;
+    for (int i = 0; i < step.count; ++i) {
+        const MusicNote &current = step.notes[i];
+
+        double             end        = clock.getTick(next) + grid * (1 + (int) (current.length * (cells - 1)));
+        unsigned long long noteLength = clock.quantise(clock.getFrame(end), grid) - next;
+        if (i == 0) {
+            length = noteLength;
+        }
+
+        // the lead note of a legato style glides to each new pitch instead of restarting
+        if (i == 0 && legato) {
+            if (mainRand() < STYLE_CHANCE[style]) {
+                float frequency = stk::Midi2Pitch[current.pitch];
+
+                if (held->note >= 0) {
+                    events[(*count)++] = NoteEvent {next, NOTE_CHANGE, held->note, held->bank, frequency, current.velocity};
+                } else {
+                    events[(*count)++] = NoteEvent {next, NOTE_HOLD, *note, STYLE_BANKS[style], frequency, current.velocity};
+                    held->note = (*note)++;
+                    held->bank = STYLE_BANKS[style];
+                }
+            }
+            continue;
+        }
+
+        // notes are released when the next one is due and ring out in their voice meanwhile
+        if (mainRand() < STYLE_CHANCE[style] && !mute) {
+            events[(*count)++] = NoteEvent {next, NOTE_ON, *note, STYLE_BANKS[style], (float) stk::Midi2Pitch[current.pitch], current.velocity};
+            events[(*count)++] = NoteEvent {next + noteLength, NOTE_OFF, *note, STYLE_BANKS[style], 0.0f, 0.5f};
+            ++(*note);
+        }
+    }
+
+    return length;
+}
+
+/**
+ * Note events for one phrase of the music
+ *
+ * Steps play the prediction for the part of the phrase they fall in. Events are handed over
+ * in time order, so those falling after the phrase, the releases of its last notes, are kept
+ * in pending for the next one
+ *
+ * Phrases run to the next bar line, where a change of style changes the tempo
+ *
+ * @param const MusicPhrase &phrase
+ * @param unsigned long long start Frame the phrase starts on, on the grid
+ * @param BeatClock *clock
+ * @param int *note Id for the next note, advanced for every note played
+ * @param HeldNote *held Lead note held by legato styles
+ * @param std::vector<NoteEvent> *pending Events left over from the last phrase
+ * @param std::vector<NoteEvent> *events Filled with the phrase's events
+ *
+ * @return unsigned long long Frame the next phrase starts on, early if this one filled up
+ */
+unsigned long long phraseEvents(const MusicPhrase &phrase, unsigned long long start, BeatClock *clock, int *note, HeldNote *held, std::vector<NoteEvent> *pending, std::vector<NoteEvent> *events) {
+    if (clock->getTempo() != STYLE_TEMPO[style]) {
+        clock->setTempo(STYLE_TEMPO[style], start);
+    }
+
+    unsigned long long end  = clock->nextBar(start);
+    unsigned long long next = start;
+
+    NoteEvent step[STEP_EVENTS];
+    int       count;
+
+    while (next < end && pending->size() + STEP_EVENTS <= (size_t) PHRASE_EVENTS) {
+        const MusicStep &predicted = phrase.steps[(next - start) * PHRASE_POINTS / (end - start)];
+
+        next += stepEvents(predicted, next, *clock, note, held, step, &count);
+        pending->insert(pending->end(), step, step + count);
+    }
+
+    std::stable_sort(pending->begin(), pending->end(), [](const NoteEvent &a, const NoteEvent &b) {
+        return a.time < b.time;
+    });
+
+    std::vector<NoteEvent>::iterator due = std::lower_bound(pending->begin(), pending->end(), next, [](const NoteEvent &event, unsigned long long time) {
+        return event.time < time;
+    });
+
+    events->assign(pending->begin(), due);
+    pending->erase(pending->begin(), due);
+
+    return next;
+}
+
+/**
+ * Sleep until a time, cut short on exit so the music thread can be joined promptly
+ *
+ * @param std::chrono::steady_clock::time_point due
+ * @return void
+ */
+void sleepUntil(std::chrono::steady_clock::time_point due) {
+    std::chrono::steady_clock::duration poll = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(EXIT_POLL));
+
+    while (!canExit && std::chrono::steady_clock::now() < due) {
+        std::this_thread::sleep_until(std::min(due, std::chrono::steady_clock::now() + poll));
+    }
+}
+
+/**
+ * Open and start the audio stream
+ *
+ * Without a buffer size, sizes are tried from the smallest up, each running for a warm-up
+ * period, and the first that neither underflows nor comes close to its deadline is kept. The
+ * warm-up plays a full bank of the current style, quietly, so the callback is timed with as
+ * many voices as the music can sound at once rather than idle
+ *
+ * @param AudioDevice *device
+ * @param AudioConfig config
+ * @param TickData *data
+ *
+ * @return bool
+ */
+bool openAudio(AudioDevice *device, AudioConfig config, TickData *data) {
+    std::vector<unsigned int> sizes;
+    if (config.bufferFrames > 0) {
+        sizes.push_back(config.bufferFrames);
+    } else {
+        sizes.assign(std::begin(PROBE_SIZES), std::end(PROBE_SIZES));
+    }
+
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        config.bufferFrames = sizes[i];
+
+        if (!device->open(config, &tick, (void *) data)) {
+            continue;
+        }
+
+        // the device may have picked another buffer size
+        data->mono.resize(device->getBufferFrames());
+        data->channels = device->getChannels();
+
+        audioMonitor.reset();
+
+        if (!device->start()) {
+            device->close();
+            continue;
+        }
+
+        // the largest size is kept whatever happens
+        if (sizes.size() == 1 || i == sizes.size() - 1) {
+            return true;
+        }
+
+        unsigned long long now = data->scheduler.getSampleTime();
+        for (int voice = 0; voice < VOICE_COUNT; ++voice) {
+            float frequency = stk::Midi2Pitch[C_MIDI_PITCH + voice * 3];
+            data->scheduler.schedule(NoteEvent {now, NOTE_ON, PROBE_NOTE + voice, STYLE_BANKS[style], frequency, PROBE_VELOCITY});
+        }
+
+        sleepUntil(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(PROBE_SECONDS)));
+
+        // released now, or when the next size starts if this one is closed
+        now = data->scheduler.getSampleTime();
+        for (int voice = 0; voice < VOICE_COUNT; ++voice) {
+            data->scheduler.schedule(NoteEvent {now, NOTE_OFF, PROBE_NOTE + voice, STYLE_BANKS[style], 0.0f, 0.5f});
+        }
+
+        if (audioMonitor.getUnderflows() == 0 && audioMonitor.getOverruns() == 0 && audioMonitor.getPercentile(0.99f) <= PROBE_LOAD) {
+            return true;
+        }
+
+        std::cout << "Audio: " << device->getBufferFrames() << " frames can't keep up, trying larger" << std::endl;
+        device->close();
     }
 
+    std::cerr << "ERROR::AUDIO::NO_STREAM" << std::endl;
+
+    return false;
+}
+
+/**
+ * The music thread
+ *
+ * @return void
+ */
+void music() {
+    TRACE_THREAD("Music");
+
+    stk::Stk::setSampleRate(audioConfig.sampleRate);
+    stk::Stk::setRawwavePath(RAWWAVE_PATH);
+
+    // every voice is allocated here, before the stream starts
+    std::unique_ptr<TickData> data;
     try {
-        dac.startStream();
-    } catch (RtAudioError &error) {
+        data.reset(new TickData());
+    } catch (stk::StkError &error) {
         error.printMessage();
-        delete data.instrument;
         return;
     }
 
+    data->partials = &partials;
+    data->monitor  = &audioMonitor;
+
+    AudioDevice device;
+    if (!openAudio(&device, audioConfig, data.get())) {
+        return;
+    }
+
+    std::cout << std::fixed << std::setprecision(1) << "Audio: " << AudioDevice::getBackendName(audioConfig.backend) << ", "
+              << device.getBufferFrames() << " frames, " << device.getPeriods() << " periods, "
+              << device.getSampleRate() << " Hz, " << device.getChannels() << " channels, "
+              << device.getLatency() * 1000.0 << " ms latency" << std::endl;
+
+    // the beat clock counts in frames of the audio clock, so event times don't depend on when
+    // this thread wakes, as long as it wakes within the margin
+    BeatClock clock(stk::Stk::sampleRate(), STYLE_TEMPO[style], BAR_BEATS);
+
+    // bars are worked out and queued a margin ahead of the audio clock, wide enough to absorb
+    // a late wakeup, while a full queue is retried a buffer later
+    unsigned long long lead   = device.getBufferFrames();
+    unsigned long long margin = std::max((unsigned long long) (PHRASE_MARGIN * stk::Stk::sampleRate()), lead * PHRASE_BUFFERS);
+    unsigned long long next   = clock.quantise(data->scheduler.getSampleTime() + margin, STYLE_GRID[style]);
+    int                note = 0;
+
+    // a phrase is read the margin before it plays, so it is predicted that far ahead
+    phraseLead = margin / stk::Stk::sampleRate();
+    HeldNote           held;
+
+    std::vector<NoteEvent> pending;
+    std::vector<NoteEvent> events;
+    pending.reserve(PHRASE_EVENTS);
+    events.reserve(PHRASE_EVENTS);
+
+    size_t queued = 0; // events of the phrase the scheduler has taken
+
     while(!canExit) {
-        data.frequency = stk::Midi2Pitch[pitch];
-        if (mainRand() < (float) style && !mute) {
-            data.instrument->noteOn(data.frequency, velocity);
+        TRACE_SCOPE("Phrase");
+
+        if (queued == events.size()) {
+            musicPhrases.update();
+
+            data->voices.setStealPolicy(stealPolicy);
+
+            next   = phraseEvents(musicPhrases.read(), next, &clock, &note, &held, &pending, &events);
+            queued = 0;
+        }
+
+        // events that don't fit in a full queue are kept, in order, for the next wakeup
+        while (queued < events.size() && data->scheduler.schedule(events[queued])) {
+            ++queued;
         }
 
-        while(!data.done) {
-            stk::Stk::sleep(noteLength);
+        // one wakeup per bar, the margin before the audio clock reaches the next one, or a
+        // buffer later while the queue drains
+        unsigned long long now    = data->scheduler.getSampleTime();
+        unsigned long long frames = 0;
+        if (queued < events.size()) {
+            frames = lead;
+        } else if (next > now + margin) {
+            frames = next - now - margin;
         }
 
-        data.counter = 0;
-        data.done    = false;
+        if (frames > 0) {
+            TRACE_SCOPE("sleep");
+            sleepUntil(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frames / stk::Stk::sampleRate())));
+        }
+
+        // the stream stalled or restarted, don't queue a burst to catch up
+        now = data->scheduler.getSampleTime();
+        if (next < now) {
+            next = clock.quantise(now + margin, STYLE_GRID[style]);
+        }
     }
 
-    try {
-        dac.closeStream();
-    } catch (RtAudioError &error) {
-        error.printMessage();
+    device.close();
+
+    audioMonitor.report(std::cout);
+}
+
+/**
+ * The music thread when another process does the sound, sending the notes out as MIDI
+ *
+ * Nothing is synthesised. Without an audio device the sample clock runs off the steady clock,
+ * and each event is sent when its frame comes round
+ *
+ * @return void
+ */
+void midi() {
+    TRACE_THREAD("Music");
+
+    stk::Stk::setSampleRate(audioConfig.sampleRate);
+
+    MidiOutput output;
+    if (!output.open(midiConfig, stk::Stk::sampleRate())) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    BeatClock clock(stk::Stk::sampleRate(), STYLE_TEMPO[style], BAR_BEATS);
+
+    unsigned long long next = 0;
+    int                note = 0;
+    HeldNote           held;
+
+    std::vector<NoteEvent> pending;
+    std::vector<NoteEvent> events;
+
+    auto waitFor = [started](unsigned long long frame) {
+        sleepUntil(started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frame / stk::Stk::sampleRate())));
+    };
+
+    while(!canExit) {
+        TRACE_SCOPE("Phrase");
+
+        // read as the phrase starts, so phraseLead is left at 0
+        musicPhrases.update();
+
+        next = phraseEvents(musicPhrases.read(), next, &clock, &note, &held, &pending, &events);
+
+        // one wakeup per event, the next bar is worked out as soon as the last one is sent
+        for (const NoteEvent &event : events) {
+            waitFor(event.time);
+            if (canExit) {
+                break;
+            }
+
+            output.play(event);
+        }
+
+        // a bar with nothing after its last event still lasts until its end
+        waitFor(next);
     }
 
-    delete data.instrument;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    output.close(elapsed * stk::Stk::sampleRate());
 }
 
 /**
@@ -663,78 +1399,374 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-int main() {
-    static GLFWwindow *window;
-    int width = 0, height = 0;
+/**
+ * Record the time since the last startup phase
+ *
+ * @param const char *name
+ *
+ * @return void
+ */
+void startupPhase(const char *name) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    startupPhases.emplace_back(name, std::chrono::duration<float, std::milli>(now - startupMark).count());
+    startupMark = now;
+}
 
-    glfwSetErrorCallback(errorCallback);
+/**
+ * Print the startup phase breakdown, once the first frame is on screen
+ *
+ * @return void
+ */
+void reportStartup() {
+    float total = 0.0f;
 
-    if (!glfwInit()) {
-        glfwTerminate();
+    std::cout << "Startup:" << std::endl;
+    for (const std::pair<std::string, float> &phase : startupPhases) {
+        std::cout << "  " << std::left << std::setw(24) << phase.first << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(8) << phase.second << " ms" << std::endl;
+
+        // phases marked as background overlap the others
+        if (phase.first.find("(background)") == std::string::npos) {
+            total += phase.second;
+        }
+    }
+    std::cout << "  " << std::left << std::setw(24) << "Time to first frame" << std::right
+              << std::setw(8) << total << " ms" << std::endl;
+}
+
+/**
+ * Bake the Nuklear font atlas, safe to run off the main thread as it touches no GL state
+ *
+ * @param nk_glfw *glfw After nk_glfw3_font_stash_begin
+ * @param int *width
+ * @param int *height
+ *
+ * @return const void* Atlas image, owned by the atlas
+ */
+const void *bakeFontAtlas(nk_glfw *glfw, int *width, int *height) {
+    return nk_font_atlas_bake(&glfw->atlas, width, height, NK_FONT_ATLAS_RGBA32);
+}
+
+/**
+ * Upload a baked font atlas and make its default font current, the GL half of nk_glfw3_font_stash_end
+ *
+ * @param nk_glfw *glfw
+ * @param nk_context *context
+ * @param const void *image
+ * @param int width
+ * @param int height
+ *
+ * @return void
+ */
+void uploadFontAtlas(nk_glfw *glfw, nk_context *context, const void *image, int width, int height) {
+    nk_glfw3_device_upload_atlas(glfw, image, width, height);
+    nk_font_atlas_end(&glfw->atlas, nk_handle_id((int) glfw->ogl.font_tex), &glfw->ogl.null);
+
+    if (glfw->atlas.default_font) {
+        nk_style_set_font(context, &glfw->atlas.default_font->handle);
+    }
+}
+
+/**
+ * Render a fixed number of frames to numbered images without a window or display
+ *
+ * The simulation advances by a fixed timestep and is seeded, so the same options give the
+ * same images. Frames are rendered as fast as the CPU and GPU allow
+ *
+ * @param const HeadlessOptions &options
+ *
+ * @return int Exit status
+ */
+int runHeadless(const HeadlessOptions &options) {
+    Offscreen offscreen(options.width, options.height);
+    if (!offscreen.isValid()) {
         return EXIT_FAILURE;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    Profiler profiler;
+    Renderer renderer;
 
-    window = glfwCreateWindow(1280, 720, "Swarm Music", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "Failed to create window" << std::endl;
-        glfwTerminate();
+    // populated here, after seeding, so runs repeat
+    seedRandom(options.seed);
+    swarm.resetAll();
+    if (options.pitch >= 0) {
+        makeScale(options.pitch);
+    }
+    setProperties();
+
+    glm::vec3 cameraPosition = glm::vec3(1500.0f * sin(theta * (PI / 180.0f)), 500.0f, 1500.0f * cos(theta * (PI / 180.0f)));
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < options.frames; ++frame) {
+        profiler.beginFrame();
+
+        deltaTime = options.timestep;
+
+        profiler.begin(PROFILE_SIMULATION);
+        swarm.swarm(deltaTime);
+        profiler.end(PROFILE_SIMULATION);
+
+        offscreen.bind();
+        renderer.draw(swarm, cameraPosition, offscreen.getWidth(), offscreen.getHeight(), detailDistance, profiler);
+
+        char name[32];
+        snprintf(name, sizeof(name), "frame_%05d.%s", frame, options.format.c_str());
+
+        if (!offscreen.writeFrame(options.output + "/" + name)) {
+            return EXIT_FAILURE;
+        }
+
+        profiler.endFrame();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << options.frames << " frames in " << elapsed << "s ("
+              << options.frames / elapsed << " fps)" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Render the music of a headless run to a WAV file, a MIDI file or both, as fast as the CPU
+ * allows
+ *
+ * The simulation runs first with the fixed timestep, collecting the note events the music
+ * thread would have scheduled, then the events are rendered in parallel segments. The WAV file
+ * has the configured channel count but only the notes, the partials of sonified agents aren't
+ * rendered, so a run with them on is refused
+ *
+ * @param const HeadlessOptions &options
+ *
+ * @return int
+ */
+int runOfflineMusic(const HeadlessOptions &options) {
+    if (sonifyAgents && !options.audio.empty()) {
+        std::cerr << "ERROR::AUDIO::PARTIALS_NOT_RENDERED " << options.audio << std::endl;
         return EXIT_FAILURE;
     }
-    glfwMakeContextCurrent(window);
-    glfwGetWindowSize(window, &width, &height);
 
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
+    stk::Stk::setSampleRate(audioConfig.sampleRate);
+    stk::Stk::setRawwavePath(RAWWAVE_PATH);
+
+    seedRandom(options.seed);
+    swarm.resetAll();
+    if (options.pitch >= 0) {
+        makeScale(options.pitch);
+    }
+    setProperties();
+
+    unsigned long long frames = options.duration * stk::Stk::sampleRate();
+
+    std::vector<NoteEvent> events;
+    std::vector<NoteEvent> pending;
+    std::vector<NoteEvent> phrase;
+
+    unsigned long long next      = 0;
+    double             simulated = 0.0; // frames of simulation time
+    int                note      = 0;
+    HeldNote           held;
+    BeatClock          clock(stk::Stk::sampleRate(), STYLE_TEMPO[style], BAR_BEATS);
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    // the music thread's loop, on the simulation clock instead of the audio clock
+    while (next < frames) {
+        deltaTime = options.timestep;
+
+        swarm.swarm(deltaTime);
+        simulated += deltaTime * stk::Stk::sampleRate();
+
+        // the next phrase is read straight away, though it may have started up to a step ago
+        playMusic((next - simulated) / stk::Stk::sampleRate());
+        musicPhrases.update();
+
+        while (next < simulated && next < frames) {
+            next = phraseEvents(musicPhrases.read(), next, &clock, &note, &held, &pending, &phrase);
+            events.insert(events.end(), phrase.begin(), phrase.end());
+        }
+    }
+    events.insert(events.end(), pending.begin(), pending.end());
+
+    double simulation = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << note << " notes simulated in " << simulation << "s" << std::endl;
+
+    if (!midiConfig.file.empty()) {
+        MidiConfig file;
+        file.file = midiConfig.file;
+
+        std::stable_sort(events.begin(), events.end(), [](const NoteEvent &a, const NoteEvent &b) {
+            return a.time < b.time;
+        });
+
+        MidiOutput output;
+        if (!output.open(file, stk::Stk::sampleRate())) {
+            return EXIT_FAILURE;
+        }
+        for (const NoteEvent &event : events) {
+            if (event.time < frames) {
+                output.play(event);
+            }
+        }
+        if (!output.close(frames)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.audio.empty()) {
+        return EXIT_SUCCESS;
+    }
+
+    int threads = options.threads > 0 ? options.threads : std::max((int) std::thread::hardware_concurrency(), 1);
+
+    OfflineRender render(events, frames, stealPolicy);
+    if (!render.write(options.audio, audioConfig.channels, threads)) {
         return EXIT_FAILURE;
     }
-    glViewport(0, 0, width, height);
 
-    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << options.duration << "s of audio in " << elapsed << "s ("
+              << options.duration / elapsed << "x real time)" << std::endl;
 
-    float cap = 1.0f / glfwGetVideoMode(glfwGetPrimaryMonitor())->refreshRate;
+    return EXIT_SUCCESS;
+}
 
-    Shader shader("./shaders/test.vs", "./shaders/test.fs");
-    Shader shaderLight("./shaders/light.vs", "./shaders/light.fs");
-    Shader shaderLightSource("./shaders/lightSource.vs", "./shaders/lightSource.fs");
+/**
+ * Read the command line options
+ *
+ * --headless [--frames N] [--size WxH] [--step S] [--seed N] [--pitch N] [--format ppm|raw] [--out DIR]
+ *            [--audio FILE.wav] [--duration S] [--threads N]
+ * [--backend default|alsa|jack|null] [--buffer FRAMES] [--periods N] [--rate HZ] [--channels N]
+ * [--midi PORT] [--midi-file FILE.mid]
+ *
+ * @param int argc
+ * @param char **argv
+ * @param HeadlessOptions *options
+ * @param AudioConfig *audio
+ * @param MidiConfig *midi
+ *
+ * @return bool Whether headless mode was requested
+ */
+bool parseOptions(int argc, char **argv, HeadlessOptions *options, AudioConfig *audio, MidiConfig *midi) {
+    bool headless = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--headless") {
+            headless = true;
+        } else if (argument == "--frames" && hasValue) {
+            options->frames = atoi(argv[++i]);
+        } else if (argument == "--size" && hasValue) {
+            sscanf(argv[++i], "%dx%d", &options->width, &options->height);
+        } else if (argument == "--step" && hasValue) {
+            options->timestep = atof(argv[++i]);
+        } else if (argument == "--seed" && hasValue) {
+            options->seed = strtoul(argv[++i], NULL, 10);
+        } else if (argument == "--pitch" && hasValue) {
+            options->pitch = atoi(argv[++i]);
+        } else if (argument == "--format" && hasValue) {
+            options->format = argv[++i];
+        } else if (argument == "--out" && hasValue) {
+            options->output = argv[++i];
+        } else if (argument == "--audio" && hasValue) {
+            options->audio = argv[++i];
+        } else if (argument == "--duration" && hasValue) {
+            options->duration = atof(argv[++i]);
+        } else if (argument == "--threads" && hasValue) {
+            options->threads = atoi(argv[++i]);
+        } else if (argument == "--backend" && hasValue) {
+            int backend = AudioDevice::parseBackend(argv[++i]);
+            if (backend < 0) {
+                std::cerr << "Unknown audio backend " << argv[i] << std::endl;
+            } else {
+                audio->backend = backend;
+            }
+        } else if (argument == "--buffer" && hasValue) {
+            audio->bufferFrames = strtoul(argv[++i], NULL, 10);
+        } else if (argument == "--periods" && hasValue) {
+            audio->periods = strtoul(argv[++i], NULL, 10);
+        } else if (argument == "--rate" && hasValue) {
+            audio->sampleRate = strtoul(argv[++i], NULL, 10);
+        } else if (argument == "--channels" && hasValue) {
+            audio->channels = std::max(strtoul(argv[++i], NULL, 10), 1ul);
+        } else if (argument == "--midi" && hasValue) {
+            midi->port = argv[++i];
+        } else if (argument == "--midi-file" && hasValue) {
+            midi->file = argv[++i];
+        } else {
+            std::cerr << "Unknown option " << argument << std::endl;
+        }
+    }
 
-    // UI
-    struct nk_glfw glfw = {0};
-    struct nk_context* context = nk_glfw3_init(&glfw, window, NK_GLFW3_INSTALL_CALLBACKS);
-	struct nk_font_atlas* atlas;
-	nk_glfw3_font_stash_begin(&glfw, &atlas);
-	nk_glfw3_font_stash_end(&glfw);
+    return headless;
+}
+
+/**
+ * Create the scene resources and run the render loop until the window is closed
+ *
+ * GL objects owned here are released before returning, while the context is still current
+ *
+ * Startup work that needs no GL context runs alongside shader compilation
+ *
+ * @param GLFWwindow *window
+ * @param nk_glfw *glfw
+ * @param nk_context *context
+ * @param std::future<float> &population Agents being added in the background, yields the time taken
+ *
+ * @return void
+ */
+void run(GLFWwindow *window, nk_glfw *glfw, nk_context *context, std::future<float> &population) {
+    int width = 0, height = 0;
+    glfwGetWindowSize(window, &width, &height);
+
+    FramePacer pacer(1.0 / glfwGetVideoMode(glfwGetPrimaryMonitor())->refreshRate, pacingMode);
+    pacer.setSpinTail(spinTail);
+
+    Profiler profiler;
+
+    struct nk_font_atlas *atlas;
+    nk_glfw3_font_stash_begin(glfw, &atlas);
+
+    int atlasWidth = 0, atlasHeight = 0;
+    float atlasTime = 0.0f;
+    std::future<const void *> fontAtlas = std::async(std::launch::async, [glfw, &atlasWidth, &atlasHeight, &atlasTime] {
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        const void *image = bakeFontAtlas(glfw, &atlasWidth, &atlasHeight);
+        atlasTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+        return image;
+    });
+
+    Renderer renderer;
+    startupPhase("Shaders and meshes");
 
-    unsigned int VBO, EBO, VAO;
-    setupWireCube(&VBO, &EBO, &VAO);
-    glm::mat4 cubeModel = glm::mat4(1.0f);
-    cubeModel = glm::scale(cubeModel, glm::vec3(400.0f, 400.0f, 400.0f));
+    FrameCapture capture;
 
-    unsigned int lightVBO, lightEBO, lightVAO;
-    // light source cube
-    setupWireCube(&lightVBO, &lightEBO, &lightVAO);
-    glm::mat4 lightModel  = glm::mat4(1.0f);
-    glm::vec3 lightPos    = glm::vec3(0.0f, 420.0f, 0.0f);
+    const void *atlasImage = fontAtlas.get();
+    startupPhase("Font atlas wait");
+    startupPhases.emplace_back("Font atlas (background)", atlasTime);
 
-    float lightAmbient  = 0.2f;
-    float lightDiffuse  = 0.75f;
-    float lightSpecular = 1.0f;
+    uploadFontAtlas(glfw, context, atlasImage, atlasWidth, atlasHeight);
+    startupPhase("Font atlas upload");
 
-    lightModel = glm::translate(lightModel, lightPos);
-    lightModel = glm::scale(lightModel, glm::vec3(0.2f));
+    float populationTime = population.get();
+    startupPhase("Swarm wait");
+    startupPhases.emplace_back("Swarm (background)", populationTime);
 
-    unsigned int agentVBO, agentNormalVBO, agentEBO, agentVAO;
-    swarm.setupDrawAgents(&agentVBO, &agentNormalVBO, &agentEBO, &agentVAO);
+    bool firstFrame = true;
 
-    unsigned int attractorVBO, attractorEBO, attractorVAO;
+    // MIDI output leaves the sound to another process. Either thread is joined on exit, so the
+    // stream is closed and the report or file written before the globals they use go away
+    bool        midiOutput = !midiConfig.port.empty() || !midiConfig.file.empty();
+    std::thread soundThread(midiOutput ? midi : music);
 
-    std::thread soundThread(music);
-    soundThread.detach();
+    TRACE_THREAD("Render");
 
 	while (!glfwWindowShouldClose(window)) {
+        TRACE_SCOPE("Frame");
+
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         deltaSum += deltaTime;
@@ -747,97 +1779,137 @@ int main() {
             deltaSum   = 0;
         }
 
+        profiler.beginFrame();
+
         glfwGetWindowSize(window, &width, &height);
 
-        glEnable(GL_DEPTH_TEST);
+        profiler.begin(PROFILE_INPUT);
         processInput(window);
+        profiler.end(PROFILE_INPUT);
 
-		nk_glfw3_new_frame(&glfw); 
-        drawUI(&glfw, context, &attractorVBO, &attractorEBO, &attractorVAO);
-
-		glClearColor(OLIVE_BLACK, OLIVE_BLACK, OLIVE_BLACK, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glm::mat4 view = glm::lookAt(glm::vec3(1500.0f * sin(theta * (PI / 180.0f)), 500.0f, 1500.0f * cos(theta * (PI / 180.0f))),
-                            glm::vec3(0.0f, -80.0f, 0.0f),
-                            glm::vec3(0.0f, 1.0f, 0.0f));
-
-        glm::mat4 projection;
-        projection = glm::perspective(glm::radians(45.0f), (float) width / (float) height, 0.1f, 2500.0f);
-
-        shaderLightSource.use();
-        shaderLightSource.setMat4("model", lightModel);
-        shaderLightSource.setMat4("view", view);
-        shaderLightSource.setMat4("projection", projection);
-
-        glBindVertexArray(lightVAO);
-        glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
-
-        shaderLight.use();
-        shaderLight.setMat4("view", view);
-        shaderLight.setMat4("projection", projection);
+        profiler.begin(PROFILE_UI);
+		nk_glfw3_new_frame(glfw); 
+        drawUI(glfw, context, pacer, capture, profiler);
+        profiler.end(PROFILE_UI);
 
-        // for wire cube
-        shaderLight.setVec3("light.ambient",  glm::vec3(1.0f, 1.0f, 1.0f));
-        shaderLight.setVec3("light.diffuse",  glm::vec3(1.0f, 1.0f, 1.0f));
-        shaderLight.setVec3("light.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-        shaderLight.setVec3("light.position", lightPos);
+        glm::vec3 cameraPosition = glm::vec3(1500.0f * sin(theta * (PI / 180.0f)), 500.0f, 1500.0f * cos(theta * (PI / 180.0f)));
 
-        // draw cube
-        glBindVertexArray(VAO);
+        renderer.draw(swarm, cameraPosition, width, height, detailDistance, profiler);
 
-        shaderLight.setMat4("model", cubeModel);
-        shaderLight.setVec3("material.ambient",  glm::vec3(0.02f, 0.02f, 0.02f));
-        shaderLight.setVec3("material.diffuse",  glm::vec3(0.01f, 0.01f, 0.01f));
-        shaderLight.setVec3("material.specular", glm::vec3(0.4f, 0.4f, 0.4f));
-        shaderLight.setFloat("material.shininess", 0.078125f * 128);
+        // record the scene without the UI, read back asynchronously
+        if (recording != capture.isRecording()) {
+            if (recording) {
+                int framebufferWidth = 0, framebufferHeight = 0;
+                glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
-        glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
+                std::stringstream pathStream;
+                pathStream << "./capture-" << time(NULL) << (captureFormat == CAPTURE_Y4M ? ".y4m" : ".rgba");
 
-        // for agents and attractors
-        shaderLight.setVec3("light.ambient",  glm::vec3(lightAmbient, lightAmbient, lightAmbient));
-        shaderLight.setVec3("light.diffuse",  glm::vec3(lightDiffuse, lightDiffuse, lightDiffuse));
-        shaderLight.setVec3("light.specular", glm::vec3(lightSpecular, lightSpecular, lightSpecular));
-
-        // draw agents
-        glBindVertexArray(agentVAO);
-        swarm.drawAgents(shaderLight);
+                recording = capture.start(pathStream.str(), framebufferWidth, framebufferHeight, captureFormat, glfwGetVideoMode(glfwGetPrimaryMonitor())->refreshRate);
+            } else {
+                capture.stop();
+            }
+        }
+        capture.capture();
 
-        glBindVertexArray(attractorVAO);
-        swarm.drawAttractors(shaderLight);
+        profiler.begin(PROFILE_DRAW_UI);
+		nk_glfw3_render(glfw, NK_ANTI_ALIASING_ON, MAX_VERTEX_BUFFER, MAX_ELEMENT_BUFFER);
+        profiler.end(PROFILE_DRAW_UI);
 
-        glBindVertexArray(0);
+		glfwSwapBuffers(window);
 
-		nk_glfw3_render(&glfw, NK_ANTI_ALIASING_ON, MAX_VERTEX_BUFFER, MAX_ELEMENT_BUFFER);
+        if (firstFrame) {
+            startupPhase("First frame");
+            reportStartup();
+            firstFrame = false;
+        }
 
-		glfwSwapBuffers(window);
+        profiler.begin(PROFILE_INPUT);
 		glfwPollEvents();
+        profiler.end(PROFILE_INPUT);
 
+        profiler.begin(PROFILE_SIMULATION);
         setProperties();
         swarm.swarm(deltaTime);
-        playMusic();
+        profiler.end(PROFILE_SIMULATION);
+
+        profiler.begin(PROFILE_MUSIC);
+        playMusic(phraseLead);
+        playPartials();
+        profiler.end(PROFILE_MUSIC);
+
+        profiler.endFrame();
 
-        while (glfwGetTime() < lastFrame + cap) {
-            // do nothing
+        if (pacer.getMode() != pacingMode) {
+            pacer.setMode(pacingMode);
         }
+        pacer.setSpinTail(spinTail);
+        pacer.wait();
 	}
 
+    canExit = true;
     if (soundThread.joinable()) {
         soundThread.join();
     }
+}
+
+int main(int argc, char **argv) {
+    static GLFWwindow *window;
+    int width = 0, height = 0;
+
+    HeadlessOptions options;
+    if (parseOptions(argc, argv, &options, &audioConfig, &midiConfig)) {
+        int status = options.audio.empty() && midiConfig.file.empty() ? runHeadless(options) : runOfflineMusic(options);
+
+        TRACE_WRITE(TRACE_PATH);
+        return status;
+    }
+
+    // agents need no GL context, populate them while the window and shaders are set up
+    std::future<float> population = std::async(std::launch::async, [] {
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        swarm.addAgents();
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &EBO);
-    glDeleteBuffers(1, &VBO);
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - started).count();
+    });
+
+    glfwSetErrorCallback(errorCallback);
+
+    if (!glfwInit()) {
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    window = glfwCreateWindow(1280, 720, "Swarm Music", NULL, NULL);
+    if (window == NULL) {
+        std::cerr << "Failed to create window" << std::endl;
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(window);
+    glfwGetWindowSize(window, &width, &height);
+
+    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return EXIT_FAILURE;
+    }
+    glViewport(0, 0, width, height);
+
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    startupPhase("Window and context");
+
+    // UI, the font atlas is baked in run()
+    struct nk_glfw glfw = {0};
+    struct nk_context* context = nk_glfw3_init(&glfw, window, NK_GLFW3_INSTALL_CALLBACKS);
+    startupPhase("UI");
 
-    glDeleteVertexArrays(1, &agentVAO);
-    glDeleteBuffers(1, &agentEBO);
-    glDeleteBuffers(1, &agentNormalVBO);
-    glDeleteBuffers(1, &agentVBO);
+    run(window, &glfw, context, population);
 
-    glDeleteVertexArrays(1, &attractorVAO);
-    glDeleteBuffers(1, &attractorEBO);
-    glDeleteBuffers(1, &attractorVBO);
+    TRACE_WRITE(TRACE_PATH);
 
 	nk_glfw3_shutdown(&glfw);
 	glfwTerminate();
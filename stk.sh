@@ -5,7 +5,7 @@ if [ -d "$DIR" ]; then
     echo "Compiling STK"
     cd ./lib/stk
     autoconf
-    ./configure --with-alsa
+    ./configure --with-alsa --with-jack
     cd ./src
     make
 else